@@ -2,11 +2,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #define MAX_LINE 2048
 #define MAX_FIELDS 16
 #define MAX_FIELD_LEN 256
+#define MAX_CATEGORY_FILTERS 16
+#define DIGEST_COMPRESSION 100
+#define DIGEST_MAX_CENTROIDS 300
+#define MAX_LARGEST 10
+#define DATE_SAMPLE_ROWS 64
 
 typedef struct {
   char date[16];
@@ -23,10 +32,45 @@ typedef struct {
   double outflow;
 } MonthStat;
 
+typedef struct {
+  double mean;
+  double weight;
+} Centroid;
+
+/*
+ * Merging t-digest: merged centroids occupy [0, count) and unmerged points
+ * [count, count + buffered). The centroid array grows lazily and never
+ * exceeds DIGEST_MAX_CENTROIDS, so each digest is bounded at ~4.8 KB.
+ */
+typedef struct {
+  Centroid *centroids;
+  size_t count;
+  size_t buffered;
+  size_t cap;
+  double total_weight;
+  double min;
+  double max;
+} TDigest;
+
+typedef struct {
+  int month_key;
+  double amount;
+} CategoryMonth;
+
 typedef struct {
   char name[64];
   double outflow;
   int count;
+  TDigest digest;
+  CategoryMonth *months;
+  size_t month_count;
+  size_t month_cap;
+  /*
+   * Space-Saving overestimate. months only holds amounts seen since the item
+   * replaced another, so its cells sum to outflow - error, not outflow.
+   */
+  double error;
+  size_t heap_pos;
 } CategoryStat;
 
 typedef struct {
@@ -35,10 +79,22 @@ typedef struct {
   size_t cap;
 } MonthList;
 
+/*
+ * slots is an open-addressing name index (item index + 1, 0 = empty). With a
+ * nonzero limit the list runs Space-Saving: heap orders items by amount and
+ * the smallest is replaced once the limit is reached, its amount carried over
+ * as the newcomer's error bound.
+ */
 typedef struct {
   CategoryStat *items;
   size_t count;
   size_t cap;
+  size_t *slots;
+  size_t slot_cap;
+  size_t limit;
+  size_t *heap;
+  size_t evicted;
+  TDigest evicted_digest;
 } CategoryList;
 
 typedef struct {
@@ -47,6 +103,173 @@ typedef struct {
   double outflow_adj;
 } Scenario;
 
+typedef struct {
+  const char *category;
+  const char *direction;
+  int month_key;
+  const char *kind;
+  double amount;
+  double mean;
+  double std_dev;
+  double z;
+} Anomaly;
+
+typedef struct {
+  Anomaly *items;
+  size_t count;
+  size_t cap;
+} AnomalyList;
+
+/*
+ * Open-addressing set of 128-bit row fingerprints. Slots are 16 bytes, kept at
+ * most 3/4 full and doubled on growth, so one unique row costs 21-43 bytes.
+ */
+typedef struct {
+  uint64_t *slots;
+  size_t cap;
+  size_t count;
+} FingerprintSet;
+
+typedef struct {
+  int date;
+  double rate;
+} FxRate;
+
+/* Rates for one currency, sorted by date key, plus its conversion coverage. */
+typedef struct {
+  char code[8];
+  FxRate *items;
+  size_t count;
+  size_t cap;
+  size_t rows;
+  size_t missing;
+  double native_total;
+  double converted_total;
+} FxSeries;
+
+typedef struct {
+  FxSeries *items;
+  size_t count;
+  size_t cap;
+  char report_currency[8];
+} FxTable;
+
+/* DATE_YM is a month-only layout (YYYY-MM); its rows read as day 1. */
+typedef enum { DATE_YMD, DATE_MDY, DATE_DMY, DATE_YM } DateOrder;
+
+/* Field order plus separator; a '\0' separator means compact YYYYMMDD. */
+typedef struct {
+  DateOrder order;
+  char sep;
+} DateFormat;
+
+typedef struct {
+  MonthList months;
+  CategoryList categories;
+  CategoryList inflow_categories;
+  size_t record_count;
+  size_t skipped;
+  size_t filtered;
+  int stopped_early;
+  size_t duplicates;
+  double duplicate_inflow;
+  double duplicate_outflow;
+  size_t dedupe_unique;
+  size_t dedupe_bytes;
+  size_t fx_native;
+  size_t fx_converted;
+  size_t fx_missing;
+  size_t fx_unknown;
+  size_t fx_unconverted;
+  DateFormat date_format;
+  size_t date_sampled;
+  size_t date_matched;
+  size_t date_mismatched;
+  TDigest inflow_digest;
+  TDigest outflow_digest;
+  Entry largest[MAX_LARGEST];
+  size_t largest_count;
+  double total_inflow;
+  double total_outflow;
+  double total_restricted;
+} Ledger;
+
+typedef struct {
+  char as_of[8];
+  char from[11];
+  char to[11];
+  const char *categories[MAX_CATEGORY_FILTERS];
+  size_t category_count;
+  const char *exclude_categories[MAX_CATEGORY_FILTERS];
+  size_t exclude_count;
+  int restricted_only;
+  int assume_sorted;
+  int dedupe;
+  FxTable *fx;
+  const char *report_currency;
+  size_t max_categories;
+  const DateFormat *date_format;
+} LedgerOptions;
+
+typedef struct {
+  double starting_cash;
+  double reserved_cash;
+  int window_months;
+  char as_of[8];
+} RunwayParams;
+
+typedef struct {
+  size_t month_count;
+  double total_inflow;
+  double total_outflow;
+  double available_cash;
+  double ending_cash;
+  double lowest_balance;
+  char lowest_balance_month[8];
+  int depletion_index;
+  double depletion_balance;
+  char depletion_month[8];
+  double peak_inflow;
+  double peak_outflow;
+  char peak_inflow_month[8];
+  char peak_outflow_month[8];
+  int deficit_months;
+  double best_net;
+  double worst_net;
+  char best_net_month[8];
+  char worst_net_month[8];
+  int longest_deficit_streak;
+  char longest_deficit_start[8];
+  char longest_deficit_end[8];
+  double largest_net_swing_abs;
+  double largest_net_swing_delta;
+  char largest_net_swing_month[8];
+  size_t month_start;
+  double avg_burn;
+  int burn_count;
+  double avg_net;
+  int net_count;
+  double avg_inflow;
+  double avg_outflow;
+  double outflow_coverage;
+  double breakeven_gap;
+  double breakeven_inflow_pct;
+  double breakeven_outflow_pct;
+  double net_volatility;
+  double runway_months;
+  const char *risk_level;
+  double target_runway_months;
+  double target_cash;
+  double funding_gap;
+  size_t trend_window;
+  size_t recent_start;
+  size_t recent_count;
+  size_t prior_count;
+  double recent_avg_net;
+  double prior_avg_net;
+  double net_trend_delta;
+} RunwaySummary;
+
 static void trim(char *s) {
   char *start = s;
   while (isspace((unsigned char)*start)) start++;
@@ -186,29 +409,411 @@ static void month_list_add(MonthList *list, const char *month, double inflow, do
   list->count++;
 }
 
-static void category_list_add(CategoryList *list, const char *name, double outflow) {
-  for (size_t i = 0; i < list->count; i++) {
-    if (strcmp(list->items[i].name, name) == 0) {
-      list->items[i].outflow += outflow;
-      list->items[i].count += 1;
+static int compare_centroids(const void *a, const void *b) {
+  const Centroid *ca = (const Centroid *)a;
+  const Centroid *cb = (const Centroid *)b;
+  return (ca->mean > cb->mean) - (ca->mean < cb->mean);
+}
+
+/* k1 scale function: each merged centroid spans at most one unit of k. */
+static double digest_q_to_k(double q) {
+  return DIGEST_COMPRESSION / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+static double digest_k_to_q(double k) {
+  if (k >= DIGEST_COMPRESSION / 4.0) return 1.0;
+  return (sin(k * 2.0 * M_PI / DIGEST_COMPRESSION) + 1.0) / 2.0;
+}
+
+/* Merges through a stack buffer so digests can be compressed concurrently. */
+static void tdigest_compress(TDigest *d) {
+  Centroid scratch[DIGEST_MAX_CENTROIDS];
+  size_t n = d->count + d->buffered;
+  if (d->buffered == 0 || n == 0) {
+    return;
+  }
+  /* The merged run is already sorted; sort only the buffer and merge the two runs. */
+  qsort(d->centroids + d->count, d->buffered, sizeof(Centroid), compare_centroids);
+  size_t a = 0;
+  size_t b = d->count;
+  for (size_t i = 0; i < n; i++) {
+    if (b >= n || (a < d->count && d->centroids[a].mean <= d->centroids[b].mean)) {
+      scratch[i] = d->centroids[a++];
+    } else {
+      scratch[i] = d->centroids[b++];
+    }
+  }
+
+  double weight_so_far = 0.0;
+  double limit = d->total_weight * digest_k_to_q(digest_q_to_k(0.0) + 1.0);
+  size_t out = 0;
+  d->centroids[0] = scratch[0];
+  for (size_t i = 1; i < n; i++) {
+    Centroid *last = &d->centroids[out];
+    const Centroid *next = &scratch[i];
+    if (weight_so_far + last->weight + next->weight <= limit) {
+      double weight = last->weight + next->weight;
+      last->mean += (next->mean - last->mean) * next->weight / weight;
+      last->weight = weight;
+    } else {
+      weight_so_far += last->weight;
+      limit = d->total_weight * digest_k_to_q(digest_q_to_k(weight_so_far / d->total_weight) + 1.0);
+      d->centroids[++out] = *next;
+    }
+  }
+  d->count = out + 1;
+  d->buffered = 0;
+}
+
+static void tdigest_add_weighted(TDigest *d, double value, double weight) {
+  if (d->count + d->buffered == d->cap) {
+    if (d->cap < DIGEST_MAX_CENTROIDS) {
+      size_t next_cap = d->cap == 0 ? 16 : d->cap * 2;
+      if (next_cap > DIGEST_MAX_CENTROIDS) next_cap = DIGEST_MAX_CENTROIDS;
+      Centroid *next = realloc(d->centroids, next_cap * sizeof(Centroid));
+      if (!next) {
+        fprintf(stderr, "Memory allocation failed for quantile sketches.\n");
+        exit(1);
+      }
+      d->centroids = next;
+      d->cap = next_cap;
+    } else {
+      tdigest_compress(d);
+    }
+  }
+  if (d->total_weight == 0.0 || value < d->min) d->min = value;
+  if (d->total_weight == 0.0 || value > d->max) d->max = value;
+  d->centroids[d->count + d->buffered].mean = value;
+  d->centroids[d->count + d->buffered].weight = weight;
+  d->buffered++;
+  d->total_weight += weight;
+}
+
+static void tdigest_add(TDigest *d, double value) {
+  tdigest_add_weighted(d, value, 1.0);
+}
+
+/* Folds src into dst; digests built on separate slices of a ledger combine losslessly in rank terms. */
+static void tdigest_merge(TDigest *dst, TDigest *src) {
+  if (src->total_weight == 0.0) {
+    return;
+  }
+  double src_min = src->min;
+  double src_max = src->max;
+  tdigest_compress(src);
+  for (size_t i = 0; i < src->count; i++) {
+    tdigest_add_weighted(dst, src->centroids[i].mean, src->centroids[i].weight);
+  }
+  if (src_min < dst->min) dst->min = src_min;
+  if (src_max > dst->max) dst->max = src_max;
+}
+
+static double tdigest_quantile(TDigest *d, double q) {
+  tdigest_compress(d);
+  if (d->count == 0) {
+    return 0.0;
+  }
+  if (d->count == 1) {
+    return d->centroids[0].mean;
+  }
+  double target = q * d->total_weight;
+  double prev_pos = 0.0;
+  double prev_value = d->min;
+  double cumulative = 0.0;
+  for (size_t i = 0; i < d->count; i++) {
+    double pos = cumulative + d->centroids[i].weight / 2.0;
+    if (target <= pos) {
+      double span = pos - prev_pos;
+      return span > 0 ? prev_value + (d->centroids[i].mean - prev_value) * (target - prev_pos) / span
+                      : d->centroids[i].mean;
+    }
+    cumulative += d->centroids[i].weight;
+    prev_pos = pos;
+    prev_value = d->centroids[i].mean;
+  }
+  double span = d->total_weight - prev_pos;
+  return span > 0 ? prev_value + (d->max - prev_value) * (target - prev_pos) / span : d->max;
+}
+
+static void tdigest_free(TDigest *d) {
+  free(d->centroids);
+  memset(d, 0, sizeof(*d));
+}
+
+/* Writes YYYY-MM (with_day 0) or YYYY-MM-DD from a date key. */
+static void format_date_key(char *dst, int key, int with_day) {
+  int year = key / 10000;
+  int month = key / 100 % 100;
+  int day = key % 100;
+  dst[0] = (char)('0' + year / 1000 % 10);
+  dst[1] = (char)('0' + year / 100 % 10);
+  dst[2] = (char)('0' + year / 10 % 10);
+  dst[3] = (char)('0' + year % 10);
+  dst[4] = '-';
+  dst[5] = (char)('0' + month / 10);
+  dst[6] = (char)('0' + month % 10);
+  if (with_day) {
+    dst[7] = '-';
+    dst[8] = (char)('0' + day / 10);
+    dst[9] = (char)('0' + day % 10);
+    dst[10] = '\0';
+  } else {
+    dst[7] = '\0';
+  }
+}
+
+/* Keeps the MAX_LARGEST biggest transactions in a min-heap keyed by amount. */
+static void largest_push(Entry *heap, size_t *count, int date_key, const char *category, double amount) {
+  size_t i;
+  if (*count < MAX_LARGEST) {
+    i = (*count)++;
+    while (i > 0 && heap[(i - 1) / 2].amount > amount) {
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+  } else if (amount > heap[0].amount) {
+    i = 0;
+    for (;;) {
+      size_t child = i * 2 + 1;
+      if (child >= MAX_LARGEST) break;
+      if (child + 1 < MAX_LARGEST && heap[child + 1].amount < heap[child].amount) child++;
+      if (heap[child].amount >= amount) break;
+      heap[i] = heap[child];
+      i = child;
+    }
+  } else {
+    return;
+  }
+  Entry *entry = &heap[i];
+  memset(entry, 0, sizeof(*entry));
+  format_date_key(entry->date, date_key, 1);
+  snprintf(entry->category, sizeof(entry->category), "%s", category);
+  entry->amount = amount;
+}
+
+static int compare_entries_desc(const void *a, const void *b) {
+  const Entry *ea = (const Entry *)a;
+  const Entry *eb = (const Entry *)b;
+  return (eb->amount > ea->amount) - (eb->amount < ea->amount);
+}
+
+/* YYYY-MM -> months since year 0, so consecutive months differ by one. */
+static int month_key_from(const char *month) {
+  int year = (month[0] - '0') * 1000 + (month[1] - '0') * 100 + (month[2] - '0') * 10 + (month[3] - '0');
+  int mon = (month[5] - '0') * 10 + (month[6] - '0');
+  return year * 12 + mon - 1;
+}
+
+static void month_from_key(int key, char *dst) {
+  snprintf(dst, 8, "%04u-%02u", (unsigned)key / 12u % 10000u, (unsigned)key % 12u + 1u);
+}
+
+/* Sparse month series: appends for date-ordered input, binary-search insert otherwise. */
+static void category_month_add(CategoryStat *stat, int month_key, double amount) {
+  if (stat->month_count > 0 && stat->months[stat->month_count - 1].month_key == month_key) {
+    stat->months[stat->month_count - 1].amount += amount;
+    return;
+  }
+  size_t pos = stat->month_count;
+  if (pos > 0 && stat->months[pos - 1].month_key > month_key) {
+    size_t lo = 0;
+    size_t hi = stat->month_count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (stat->months[mid].month_key < month_key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (stat->months[lo].month_key == month_key) {
+      stat->months[lo].amount += amount;
       return;
     }
+    pos = lo;
   }
-  if (list->count == list->cap) {
-    size_t next_cap = list->cap == 0 ? 16 : list->cap * 2;
-    CategoryStat *next = realloc(list->items, next_cap * sizeof(CategoryStat));
+  if (stat->month_count == stat->month_cap) {
+    size_t next_cap = stat->month_cap == 0 ? 4 : stat->month_cap * 2;
+    CategoryMonth *next = realloc(stat->months, next_cap * sizeof(CategoryMonth));
     if (!next) {
-      fprintf(stderr, "Memory allocation failed for categories.\n");
+      fprintf(stderr, "Memory allocation failed for category months.\n");
       exit(1);
     }
-    list->items = next;
-    list->cap = next_cap;
+    stat->months = next;
+    stat->month_cap = next_cap;
+  }
+  memmove(&stat->months[pos + 1], &stat->months[pos], (stat->month_count - pos) * sizeof(CategoryMonth));
+  stat->months[pos].month_key = month_key;
+  stat->months[pos].amount = amount;
+  stat->month_count++;
+}
+
+static uint64_t mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static uint64_t hash_name(const char *name) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (const char *p = name; *p; p++) {
+    h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+  }
+  return mix64(h);
+}
+
+static size_t *category_slot(CategoryList *list, const char *name) {
+  size_t pos = (size_t)hash_name(name) & (list->slot_cap - 1);
+  while (list->slots[pos] != 0 && strcmp(list->items[list->slots[pos] - 1].name, name) != 0) {
+    pos = (pos + 1) & (list->slot_cap - 1);
+  }
+  return &list->slots[pos];
+}
+
+static void category_index_grow(CategoryList *list) {
+  size_t next_cap = list->slot_cap == 0 ? 64 : list->slot_cap * 2;
+  free(list->slots);
+  list->slots = calloc(next_cap, sizeof(size_t));
+  if (!list->slots) {
+    fprintf(stderr, "Memory allocation failed for category index.\n");
+    exit(1);
+  }
+  list->slot_cap = next_cap;
+  for (size_t i = 0; i < list->count; i++) {
+    *category_slot(list, list->items[i].name) = i + 1;
+  }
+}
+
+/* Backward-shift deletion keeps linear probe chains intact without tombstones. */
+static void category_index_remove(CategoryList *list, const char *name) {
+  size_t mask = list->slot_cap - 1;
+  size_t hole = (size_t)(category_slot(list, name) - list->slots);
+  list->slots[hole] = 0;
+  for (size_t pos = (hole + 1) & mask; list->slots[pos] != 0; pos = (pos + 1) & mask) {
+    size_t home = (size_t)hash_name(list->items[list->slots[pos] - 1].name) & mask;
+    if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+      list->slots[hole] = list->slots[pos];
+      list->slots[pos] = 0;
+      hole = pos;
+    }
+  }
+}
+
+static void category_heap_swap(CategoryList *list, size_t a, size_t b) {
+  size_t item = list->heap[a];
+  list->heap[a] = list->heap[b];
+  list->heap[b] = item;
+  list->items[list->heap[a]].heap_pos = a;
+  list->items[list->heap[b]].heap_pos = b;
+}
+
+static void category_heap_sift_up(CategoryList *list, size_t pos) {
+  while (pos > 0 && list->items[list->heap[(pos - 1) / 2]].outflow > list->items[list->heap[pos]].outflow) {
+    category_heap_swap(list, pos, (pos - 1) / 2);
+    pos = (pos - 1) / 2;
+  }
+}
+
+static void category_heap_sift_down(CategoryList *list, size_t pos) {
+  for (;;) {
+    size_t smallest = pos;
+    size_t left = pos * 2 + 1;
+    size_t right = left + 1;
+    if (left < list->count && list->items[list->heap[left]].outflow < list->items[list->heap[smallest]].outflow) {
+      smallest = left;
+    }
+    if (right < list->count && list->items[list->heap[right]].outflow < list->items[list->heap[smallest]].outflow) {
+      smallest = right;
+    }
+    if (smallest == pos) return;
+    category_heap_swap(list, pos, smallest);
+    pos = smallest;
+  }
+}
+
+static void category_heap_push(CategoryList *list, size_t item) {
+  size_t pos = list->count - 1;
+  list->heap[pos] = item;
+  list->items[item].heap_pos = pos;
+  category_heap_sift_up(list, pos);
+}
+
+static void category_stat_reset(CategoryStat *stat, const char *name) {
+  snprintf(stat->name, sizeof(stat->name), "%s", name);
+  stat->outflow = 0.0;
+  stat->count = 0;
+  stat->error = 0.0;
+  stat->month_count = 0;
+}
+
+static void category_list_add(CategoryList *list, const char *name, double outflow, int month_key) {
+  char key[64];
+  snprintf(key, sizeof(key), "%s", name);
+  if ((list->count + 1) * 2 > list->slot_cap) {
+    category_index_grow(list);
+  }
+  size_t *slot = category_slot(list, key);
+  CategoryStat *stat;
+  if (*slot != 0) {
+    stat = &list->items[*slot - 1];
+  } else if (list->limit > 0 && list->count == list->limit) {
+    stat = &list->items[list->heap[0]];
+    double carried = stat->outflow;
+    int carried_count = stat->count;
+    tdigest_merge(&list->evicted_digest, &stat->digest);
+    tdigest_free(&stat->digest);
+    category_index_remove(list, stat->name);
+    category_stat_reset(stat, key);
+    stat->outflow = carried;
+    stat->count = carried_count;
+    stat->error = carried;
+    *category_slot(list, key) = list->heap[0] + 1;
+    list->evicted++;
+  } else {
+    if (list->count == list->cap) {
+      size_t next_cap = list->cap == 0 ? 16 : list->cap * 2;
+      CategoryStat *next = realloc(list->items, next_cap * sizeof(CategoryStat));
+      size_t *next_heap = list->limit > 0 ? realloc(list->heap, next_cap * sizeof(size_t)) : NULL;
+      if (!next || (list->limit > 0 && !next_heap)) {
+        fprintf(stderr, "Memory allocation failed for categories.\n");
+        exit(1);
+      }
+      list->items = next;
+      list->heap = next_heap;
+      list->cap = next_cap;
+    }
+    stat = &list->items[list->count];
+    memset(stat, 0, sizeof(*stat));
+    category_stat_reset(stat, key);
+    *slot = ++list->count;
+    if (list->limit > 0) {
+      category_heap_push(list, list->count - 1);
+    }
+  }
+  stat->outflow += outflow;
+  stat->count += 1;
+  tdigest_add(&stat->digest, outflow);
+  category_month_add(stat, month_key, outflow);
+  /* Signed rows (refunds, reversals) can shrink a counter, so restore the heap in either direction. */
+  if (list->limit > 0) {
+    if (outflow < 0) {
+      category_heap_sift_up(list, stat->heap_pos);
+    } else {
+      category_heap_sift_down(list, stat->heap_pos);
+    }
   }
-  strncpy(list->items[list->count].name, name, sizeof(list->items[list->count].name) - 1);
-  list->items[list->count].name[sizeof(list->items[list->count].name) - 1] = '\0';
-  list->items[list->count].outflow = outflow;
-  list->items[list->count].count = 1;
-  list->count++;
+}
+
+/* Drops the ingest-only index and heap before the items are re-sorted for reporting. */
+static void category_list_finish(CategoryList *list) {
+  free(list->slots);
+  free(list->heap);
+  list->slots = NULL;
+  list->heap = NULL;
+  list->slot_cap = 0;
 }
 
 static int compare_months(const void *a, const void *b) {
@@ -247,7 +852,30 @@ static void print_usage() {
   printf("  --reserved-cash AMOUNT  Reserved/restricted cash to exclude from runway\n");
   printf("  --window MONTHS         Use last N months for average burn calculation\n");
   printf("  --as-of YYYY-MM         Ignore transactions after a given month\n");
+  printf("  --from DATE             Ignore transactions before DATE (YYYY-MM or YYYY-MM-DD)\n");
+  printf("  --to DATE               Ignore transactions after DATE (YYYY-MM or YYYY-MM-DD)\n");
+  printf("  --category GLOB         Keep only categories matching GLOB (repeatable, * and ?)\n");
+  printf("  --exclude-category GLOB Drop categories matching GLOB (repeatable)\n");
+  printf("  --restricted-only       Keep only rows flagged as restricted\n");
+  printf("  --date-format FMT       Date layout, e.g. MM/DD/YYYY, DD.MM.YYYY, YYYY-MM (default: detect per file)\n");
+  printf("  --sorted                Input is date-sorted; stop reading past the upper date bound\n");
+  printf("  --dedupe                Drop exact duplicate rows (date, amount, type, category, reference)\n");
+  printf("  --max-categories N      Approximate mode: track only the top N categories per direction\n");
+  printf("  --fx-rates PATH         CSV of date, currency, rate used to convert a currency column\n");
+  printf("  --report-currency CODE  Currency the report is expressed in (default USD)\n");
+  printf("  --anomaly-z Z           Flag category months deviating more than Z std devs (default 3)\n");
+  printf("  --commitments PATH      Dated future inflows/outflows (date, amount, type[, end, every]) to project\n");
+  printf("  --horizon MONTHS        Months projected with --commitments (default 36)\n");
+  printf("  --budget PATH           Budget CSV (month, category, amount[, type]) compared against actuals\n");
+  printf("  --sensitivity-cut PCT   Per-category cut evaluated by the runway sensitivity solver (default 10)\n");
   printf("  --json PATH             Write JSON report to PATH\n");
+  printf("  --arrow DIR             Write months/categories/scenarios as Arrow IPC files in DIR\n");
+  printf("  --history-file PATH     Append this run's summary and month balances to a local history file\n");
+  printf("  --history PATH          Print runway/burn trends from a history file (no --file needed)\n");
+  printf("  --queries PATH          Answer a CSV of what-if parameter sets (id, as_of, window,\n");
+  printf("                          starting_cash, reserved_cash) against the loaded ledger\n");
+  printf("  --query-out PATH        Write query results to PATH instead of stdout\n");
+  printf("  --query-format FORMAT   Query result format: ndjson (default) or json\n");
   printf("  --help                  Show this help\n");
 }
 
@@ -298,17 +926,2849 @@ static double parse_amount(const char *value, int *ok) {
   if (negative) {
     amt = -amt;
   }
-  return amt;
+  return amt;
+}
+
+
+static void fprint_json_string(FILE *out, const char *value) {
+  fputc('"', out);
+  for (const char *p = value; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\') {
+      fputc('\\', out);
+      fputc(c, out);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static int is_valid_month(const char *value) {
+  return strlen(value) == 7 && value[4] == '-' && isdigit((unsigned char)value[0]) &&
+         isdigit((unsigned char)value[1]) && isdigit((unsigned char)value[2]) &&
+         isdigit((unsigned char)value[3]) && isdigit((unsigned char)value[5]) &&
+         isdigit((unsigned char)value[6]);
+}
+
+static void copy_month(char *dst, const char *src) {
+  size_t len = strnlen(src, 7);
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+static int is_valid_date_bound(const char *value) {
+  size_t len = strlen(value);
+  if (len != 7 && len != 10) {
+    return 0;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (i == 4 || i == 7) {
+      if (value[i] != '-') return 0;
+    } else if (!isdigit((unsigned char)value[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Case-insensitive glob match supporting '*' and '?'. */
+static int glob_match(const char *pattern, const char *text) {
+  const char *star = NULL;
+  const char *resume = NULL;
+  while (*text) {
+    if (*pattern == '*') {
+      star = pattern++;
+      resume = text;
+    } else if (*pattern == '?' || tolower((unsigned char)*pattern) == tolower((unsigned char)*text)) {
+      pattern++;
+      text++;
+    } else if (star) {
+      pattern = star + 1;
+      text = ++resume;
+    } else {
+      return 0;
+    }
+  }
+  while (*pattern == '*') pattern++;
+  return *pattern == '\0';
+}
+
+static int category_passes(const LedgerOptions *opts, const char *category) {
+  if (opts->category_count > 0) {
+    int matched = 0;
+    for (size_t i = 0; i < opts->category_count && !matched; i++) {
+      matched = glob_match(opts->categories[i], category);
+    }
+    if (!matched) return 0;
+  }
+  for (size_t i = 0; i < opts->exclude_count; i++) {
+    if (glob_match(opts->exclude_categories[i], category)) return 0;
+  }
+  return 1;
+}
+
+/* Feeds one field into both fingerprint lanes, followed by a unit separator. */
+static void fingerprint_field(uint64_t lanes[2], const char *value, int fold_case) {
+  for (const char *p = value;; p++) {
+    unsigned char c = *p ? (unsigned char)*p : 0x1f;
+    if (fold_case) c = (unsigned char)tolower(c);
+    lanes[0] = (lanes[0] ^ c) * 0x100000001b3ULL;
+    lanes[1] = (lanes[1] ^ c) * 0x9e3779b97f4a7c15ULL;
+    if (!*p) break;
+  }
+}
+
+static void fingerprint_u64(uint64_t lanes[2], uint64_t value) {
+  lanes[0] = (lanes[0] ^ value) * 0x100000001b3ULL;
+  lanes[1] = (lanes[1] ^ value) * 0x9e3779b97f4a7c15ULL;
+}
+
+static void write_digest_fields(FILE *out, TDigest *d) {
+  fprintf(out, "\"count\": %.0f, \"median\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f",
+          d->total_weight, tdigest_quantile(d, 0.5), tdigest_quantile(d, 0.9), tdigest_quantile(d, 0.99),
+          d->total_weight > 0 ? d->max : 0.0);
+}
+
+static void fingerprint_set_grow(FingerprintSet *set) {
+  size_t next_cap = set->cap == 0 ? 1024 : set->cap * 2;
+  uint64_t *next = calloc(next_cap * 2, sizeof(uint64_t));
+  if (!next) {
+    fprintf(stderr, "Memory allocation failed for dedupe set.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < set->cap; i++) {
+    uint64_t hi = set->slots[i * 2];
+    if (hi == 0) continue;
+    size_t pos = (size_t)hi & (next_cap - 1);
+    while (next[pos * 2] != 0) pos = (pos + 1) & (next_cap - 1);
+    next[pos * 2] = hi;
+    next[pos * 2 + 1] = set->slots[i * 2 + 1];
+  }
+  free(set->slots);
+  set->slots = next;
+  set->cap = next_cap;
+}
+
+/* Returns 1 when the fingerprint was new, 0 when it was already present. */
+static int fingerprint_set_insert(FingerprintSet *set, uint64_t hi, uint64_t lo) {
+  if ((set->count + 1) * 4 > set->cap * 3) {
+    fingerprint_set_grow(set);
+  }
+  hi |= 1;
+  size_t pos = (size_t)hi & (set->cap - 1);
+  while (set->slots[pos * 2] != 0) {
+    if (set->slots[pos * 2] == hi && set->slots[pos * 2 + 1] == lo) {
+      return 0;
+    }
+    pos = (pos + 1) & (set->cap - 1);
+  }
+  set->slots[pos * 2] = hi;
+  set->slots[pos * 2 + 1] = lo;
+  set->count++;
+  return 1;
+}
+
+/* Integer YYYYMMDD key for a YYYY-MM-DD (or YYYY-MM, as day 1) date; -1 when malformed. */
+static int iso_date_key(const char *value) {
+  size_t len = strlen(value);
+  if (len < 7 || value[4] != '-') {
+    return -1;
+  }
+  for (size_t i = 0; i < 7; i++) {
+    if (i != 4 && !isdigit((unsigned char)value[i])) return -1;
+  }
+  int year = (value[0] - '0') * 1000 + (value[1] - '0') * 100 + (value[2] - '0') * 10 + (value[3] - '0');
+  int month = (value[5] - '0') * 10 + (value[6] - '0');
+  int day = 1;
+  if (len >= 10 && value[7] == '-' && isdigit((unsigned char)value[8]) && isdigit((unsigned char)value[9])) {
+    day = (value[8] - '0') * 10 + (value[9] - '0');
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31) {
+    return -1;
+  }
+  return year * 10000 + month * 100 + day;
+}
+
+/* Candidate formats in tie-break order: ISO first, then US before EU for slashes. */
+static const DateFormat DATE_FORMATS[] = {
+    {DATE_YMD, '-'}, {DATE_YMD, '/'}, {DATE_YMD, '.'}, {DATE_MDY, '/'}, {DATE_DMY, '/'},
+    {DATE_DMY, '.'}, {DATE_DMY, '-'}, {DATE_MDY, '-'}, {DATE_MDY, '.'}, {DATE_YMD, '\0'},
+    {DATE_YM, '-'},  {DATE_YM, '/'},
+};
+#define DATE_FORMAT_COUNT (sizeof(DATE_FORMATS) / sizeof(DATE_FORMATS[0]))
+
+static void date_format_name(const DateFormat *fmt, char *dst) {
+  static const char *layouts[] = {"YYYY_MM_DD", "MM_DD_YYYY", "DD_MM_YYYY", "YYYY_MM"};
+  size_t j = 0;
+  for (const char *p = layouts[fmt->order]; *p; p++) {
+    if (*p != '_') {
+      dst[j++] = *p;
+    } else if (fmt->sep) {
+      dst[j++] = fmt->sep;
+    }
+  }
+  dst[j] = '\0';
+}
+
+/* Resolves a --date-format name such as DD.MM.YYYY; NULL when unknown. */
+static const DateFormat *date_format_lookup(const char *name) {
+  char candidate[16];
+  for (size_t i = 0; i < DATE_FORMAT_COUNT; i++) {
+    date_format_name(&DATE_FORMATS[i], candidate);
+    if (strcmp(candidate, name) == 0) {
+      return &DATE_FORMATS[i];
+    }
+  }
+  return NULL;
+}
+
+/* Reads up to max_digits digits into *value; returns the number consumed. */
+static int read_date_digits(const char **p, int max_digits, int *value) {
+  const char *s = *p;
+  int n = 0;
+  int v = 0;
+  while (n < max_digits && (unsigned)(s[n] - '0') < 10u) {
+    v = v * 10 + (s[n] - '0');
+    n++;
+  }
+  *p = s + n;
+  *value = v;
+  return n;
+}
+
+/*
+ * Integer YYYYMMDD key for value in the given format, or -1 when it does not
+ * match. Years need four digits, day and month one or two; a time suffix after
+ * the date is ignored. Month-only formats yield day 1.
+ */
+static int parse_date_key(const char *value, const DateFormat *fmt) {
+  static const int widths[4][3] = {{4, 2, 2}, {2, 2, 4}, {2, 2, 4}, {4, 2, 0}};
+  const int *width = widths[fmt->order];
+  int parts = fmt->order == DATE_YM ? 2 : 3;
+  int part[3] = {0, 0, 1};
+  const char *p = value;
+  for (int i = 0; i < parts; i++) {
+    int n = read_date_digits(&p, width[i], &part[i]);
+    if (n == 0 || (width[i] == 4 && n != 4) || (fmt->sep == '\0' && n != width[i])) {
+      return -1;
+    }
+    if (i < parts - 1 && fmt->sep != '\0' && *p++ != fmt->sep) {
+      return -1;
+    }
+  }
+  if ((unsigned)(*p - '0') < 10u || (parts == 2 && *p == fmt->sep)) {
+    return -1;
+  }
+  int year = fmt->order == DATE_YMD ? part[0] : part[2];
+  int month = fmt->order == DATE_DMY ? part[1] : fmt->order == DATE_MDY ? part[0] : part[1];
+  int day = fmt->order == DATE_DMY ? part[0] : fmt->order == DATE_MDY ? part[1] : part[2];
+  static const int month_days[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  if (month < 1 || month > 12 || day < 1 || day > month_days[month - 1]) {
+    return -1;
+  }
+  if (month == 2 && day == 29 && (year % 4 != 0 || (year % 100 == 0 && year % 400 != 0))) {
+    return -1;
+  }
+  return year * 10000 + month * 100 + day;
+}
+
+/*
+ * Picks the format that parses the most sampled date fields and stores that
+ * count in *matched. Ties go to the earlier entry in DATE_FORMATS, so a file
+ * whose days never exceed 12 reads as US for slashes and as day-first for dots.
+ */
+static DateFormat detect_date_format(char samples[][MAX_FIELD_LEN], size_t count, size_t *matched) {
+  size_t best = 0;
+  size_t best_hits = 0;
+  for (size_t f = 0; f < DATE_FORMAT_COUNT; f++) {
+    size_t hits = 0;
+    for (size_t i = 0; i < count; i++) {
+      hits += parse_date_key(samples[i], &DATE_FORMATS[f]) >= 0;
+    }
+    if (hits > best_hits) {
+      best = f;
+      best_hits = hits;
+    }
+  }
+  *matched = best_hits;
+  return DATE_FORMATS[best];
+}
+
+static void normalize_currency(const char *src, char *dst) {
+  size_t j = 0;
+  for (size_t i = 0; src[i] != '\0' && j < 7; i++) {
+    if (!isspace((unsigned char)src[i])) {
+      dst[j++] = (char)toupper((unsigned char)src[i]);
+    }
+  }
+  dst[j] = '\0';
+}
+
+static FxSeries *fx_table_find(FxTable *table, const char *code) {
+  for (size_t i = 0; i < table->count; i++) {
+    if (strcmp(table->items[i].code, code) == 0) {
+      return &table->items[i];
+    }
+  }
+  return NULL;
+}
+
+static FxSeries *fx_table_series(FxTable *table, const char *code) {
+  FxSeries *found = fx_table_find(table, code);
+  if (found) {
+    return found;
+  }
+  if (table->count == table->cap) {
+    size_t next_cap = table->cap == 0 ? 8 : table->cap * 2;
+    FxSeries *next = realloc(table->items, next_cap * sizeof(FxSeries));
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for FX rates.\n");
+      exit(1);
+    }
+    table->items = next;
+    table->cap = next_cap;
+  }
+  FxSeries *series = &table->items[table->count++];
+  memset(series, 0, sizeof(*series));
+  strcpy(series->code, code);
+  return series;
+}
+
+static void fx_series_add(FxSeries *series, int date, double rate) {
+  if (series->count == series->cap) {
+    size_t next_cap = series->cap == 0 ? 64 : series->cap * 2;
+    FxRate *next = realloc(series->items, next_cap * sizeof(FxRate));
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for FX rates.\n");
+      exit(1);
+    }
+    series->items = next;
+    series->cap = next_cap;
+  }
+  series->items[series->count].date = date;
+  series->items[series->count].rate = rate;
+  series->count++;
+}
+
+static int compare_fx_rates(const void *a, const void *b) {
+  const FxRate *ra = (const FxRate *)a;
+  const FxRate *rb = (const FxRate *)b;
+  return (ra->date > rb->date) - (ra->date < rb->date);
+}
+
+/* Latest rate on or before date; 0 when the series has no rate that early. */
+static double fx_series_lookup(const FxSeries *series, int date) {
+  size_t lo = 0;
+  size_t hi = series->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (series->items[mid].date <= date) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? series->items[lo - 1].rate : 0.0;
+}
+
+/* Rates are quoted as report-currency units per one unit of the row currency. */
+static int load_fx_rates(const char *path, FxTable *table) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Failed to open FX rates file: %s\n", path);
+    return 1;
+  }
+  char line[MAX_LINE];
+  char fields[MAX_FIELDS][MAX_FIELD_LEN];
+  int header_parsed = 0;
+  int idx_date = -1, idx_currency = -1, idx_rate = -1;
+  size_t rejected = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    if (!header_parsed) {
+      for (int i = 0; i < field_count; i++) {
+        char key[MAX_FIELD_LEN];
+        normalize_key(fields[i], key, sizeof(key));
+        if (strcmp(key, "date") == 0 || strcmp(key, "ratedate") == 0) {
+          idx_date = i;
+        } else if (strcmp(key, "currency") == 0 || strcmp(key, "ccy") == 0 || strcmp(key, "code") == 0) {
+          idx_currency = i;
+        } else if (strcmp(key, "rate") == 0 || strcmp(key, "fxrate") == 0) {
+          idx_rate = i;
+        }
+      }
+      header_parsed = 1;
+      if (idx_date == -1 || idx_currency == -1 || idx_rate == -1) {
+        fprintf(stderr, "Missing FX headers. Need date, currency, rate.\n");
+        fclose(fp);
+        return 1;
+      }
+      continue;
+    }
+    if (field_count <= idx_date || field_count <= idx_currency || field_count <= idx_rate) {
+      rejected++;
+      continue;
+    }
+    int ok = 0;
+    int date = iso_date_key(fields[idx_date]);
+    double rate = parse_amount(fields[idx_rate], &ok);
+    char code[8];
+    normalize_currency(fields[idx_currency], code);
+    if (date < 0 || !ok || rate <= 0.0 || code[0] == '\0') {
+      rejected++;
+      continue;
+    }
+    fx_series_add(fx_table_series(table, code), date, rate);
+  }
+  fclose(fp);
+  for (size_t i = 0; i < table->count; i++) {
+    qsort(table->items[i].items, table->items[i].count, sizeof(FxRate), compare_fx_rates);
+  }
+  if (rejected > 0) {
+    fprintf(stderr, "Warning: ignored %zu malformed FX rate rows.\n", rejected);
+  }
+  return 0;
+}
+
+static void fx_table_free(FxTable *table) {
+  for (size_t i = 0; i < table->count; i++) {
+    free(table->items[i].items);
+  }
+  free(table->items);
+}
+
+static void category_list_free(CategoryList *list) {
+  for (size_t i = 0; i < list->count; i++) {
+    tdigest_free(&list->items[i].digest);
+    free(list->items[i].months);
+  }
+  free(list->items);
+  category_list_finish(list);
+  tdigest_free(&list->evicted_digest);
+}
+
+static void ledger_free(Ledger *ledger) {
+  free(ledger->months.items);
+  category_list_free(&ledger->categories);
+  category_list_free(&ledger->inflow_categories);
+  tdigest_free(&ledger->inflow_digest);
+  tdigest_free(&ledger->outflow_digest);
+}
+
+/*
+ * Filters run on the raw date/category/restricted fields before any amount
+ * parsing or aggregation; rows they reject count as filtered, not skipped.
+ */
+static int load_ledger(const char *file_path, const LedgerOptions *opts, Ledger *ledger) {
+  FILE *fp = fopen(file_path, "r");
+  if (!fp) {
+    fprintf(stderr, "Failed to open file: %s\n", file_path);
+    return 1;
+  }
+
+  char line[MAX_LINE];
+  char fields[MAX_FIELDS][MAX_FIELD_LEN];
+  int idx_date = -1, idx_amount = -1, idx_type = -1, idx_category = -1, idx_restricted = -1;
+  int check_categories = opts->category_count > 0 || opts->exclude_count > 0;
+  int idx_reference = -1;
+  int idx_currency = -1;
+  FxSeries *last_series = NULL;
+  int early_stop = opts->assume_sorted;
+  int last_key = 0;
+  FingerprintSet seen = {0};
+  ledger->categories.limit = opts->max_categories;
+  ledger->inflow_categories.limit = opts->max_categories;
+
+  int lower_key = opts->from[0] != '\0' ? iso_date_key(opts->from) : 0;
+  int upper_key = 99999999;
+  if (opts->to[0] != '\0') {
+    upper_key = iso_date_key(opts->to) + (strlen(opts->to) == 7 ? 30 : 0);
+  }
+  if (opts->as_of[0] != '\0' && iso_date_key(opts->as_of) + 30 < upper_key) {
+    upper_key = iso_date_key(opts->as_of) + 30;
+  }
+
+  if (fgets(line, sizeof(line), fp)) {
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    for (int i = 0; i < field_count; i++) {
+      char key[MAX_FIELD_LEN];
+      normalize_key(fields[i], key, sizeof(key));
+      if (strcmp(key, "date") == 0 || strcmp(key, "transactiondate") == 0 || strcmp(key, "txn") == 0 || strcmp(key, "txndate") == 0) {
+        idx_date = i;
+      } else if (strcmp(key, "amount") == 0 || strcmp(key, "value") == 0 || strcmp(key, "net") == 0) {
+        idx_amount = i;
+      } else if (strcmp(key, "type") == 0 || strcmp(key, "direction") == 0 || strcmp(key, "flow") == 0) {
+        idx_type = i;
+      } else if (strcmp(key, "category") == 0 || strcmp(key, "memo") == 0 || strcmp(key, "bucket") == 0) {
+        idx_category = i;
+      } else if (strcmp(key, "restricted") == 0 || strcmp(key, "restrictedflag") == 0 || strcmp(key, "restrictedfunds") == 0) {
+        idx_restricted = i;
+      } else if (strcmp(key, "reference") == 0 || strcmp(key, "referenceid") == 0 || strcmp(key, "ref") == 0 ||
+                 strcmp(key, "transactionid") == 0 || strcmp(key, "txnid") == 0 || strcmp(key, "id") == 0) {
+        idx_reference = i;
+      } else if (strcmp(key, "currency") == 0 || strcmp(key, "ccy") == 0 || strcmp(key, "currencycode") == 0) {
+        idx_currency = i;
+      }
+    }
+  }
+  if (idx_date == -1 || idx_amount == -1 || idx_type == -1 || idx_category == -1) {
+    fprintf(stderr, "Missing required headers. Need date, amount, type, category.\n");
+    fclose(fp);
+    return 1;
+  }
+
+  /*
+   * Buffer the first rows so the date format is detected once per file; the
+   * main loop replays them before reading on.
+   */
+  char (*sample)[MAX_LINE] = NULL;
+  size_t sample_count = 0;
+  size_t sample_next = 0;
+  if (opts->date_format) {
+    ledger->date_format = *opts->date_format;
+  } else {
+    sample = malloc(DATE_SAMPLE_ROWS * sizeof(*sample));
+    char (*sample_dates)[MAX_FIELD_LEN] = malloc(DATE_SAMPLE_ROWS * sizeof(*sample_dates));
+    if (!sample || !sample_dates) {
+      fprintf(stderr, "Memory allocation failed for date sample.\n");
+      exit(1);
+    }
+    size_t date_count = 0;
+    while (sample_count < DATE_SAMPLE_ROWS && fgets(sample[sample_count], MAX_LINE, fp)) {
+      int field_count = parse_csv_line(sample[sample_count++], fields, MAX_FIELDS);
+      if (field_count > idx_date && fields[idx_date][0] != '\0') {
+        memcpy(sample_dates[date_count++], fields[idx_date], MAX_FIELD_LEN);
+      }
+    }
+    ledger->date_format = detect_date_format(sample_dates, date_count, &ledger->date_matched);
+    ledger->date_sampled = date_count;
+    free(sample_dates);
+    if (date_count > 0 && ledger->date_matched == 0) {
+      fprintf(stderr, "Warning: no date format matched the %zu sampled rows; use --date-format.\n", date_count);
+    }
+  }
+  const DateFormat *date_format = &ledger->date_format;
+
+  for (;;) {
+    if (sample_next < sample_count) {
+      memcpy(line, sample[sample_next++], MAX_LINE);
+    } else if (!fgets(line, sizeof(line), fp)) {
+      break;
+    }
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    if (field_count <= idx_amount || field_count <= idx_date) {
+      ledger->skipped++;
+      continue;
+    }
+
+    const char *date = fields[idx_date];
+    int date_key = parse_date_key(date, date_format);
+    if (date_key < 0) {
+      ledger->date_mismatched++;
+      ledger->skipped++;
+      continue;
+    }
+
+    if (early_stop) {
+      if (date_key < last_key) {
+        fprintf(stderr, "Warning: --sorted input is out of date order near %s; reading the full file.\n", date);
+        early_stop = 0;
+      } else {
+        last_key = date_key;
+      }
+    }
+    if (date_key > upper_key) {
+      if (early_stop) {
+        ledger->stopped_early = 1;
+        break;
+      }
+      ledger->filtered++;
+      continue;
+    }
+    if (date_key < lower_key) {
+      ledger->filtered++;
+      continue;
+    }
+
+    const char *category = idx_category >= 0 && idx_category < field_count && fields[idx_category][0]
+                               ? fields[idx_category]
+                               : "Uncategorized";
+    if (check_categories && !category_passes(opts, category)) {
+      ledger->filtered++;
+      continue;
+    }
+
+    int restricted = 0;
+    if (idx_restricted >= 0 && idx_restricted < field_count) {
+      restricted = is_truthy(fields[idx_restricted]);
+    }
+    if (opts->restricted_only && !restricted) {
+      ledger->filtered++;
+      continue;
+    }
+
+    int ok = 0;
+    double amount = parse_amount(fields[idx_amount], &ok);
+    if (!ok) {
+      ledger->skipped++;
+      continue;
+    }
+
+    char month[8];
+    format_date_key(month, date_key, 0);
+    int month_key = date_key / 10000 * 12 + date_key / 100 % 100 - 1;
+
+    const char *type = fields[idx_type];
+    int is_inflow = 0;
+    if (is_inflow_type(type)) {
+      is_inflow = 1;
+    } else if (is_outflow_type(type)) {
+      is_inflow = 0;
+    } else if (amount < 0) {
+      is_inflow = 0;
+      amount = -amount;
+    } else {
+      is_inflow = 1;
+    }
+
+    const char *currency = "";
+    if (opts->fx) {
+      char code[8];
+      normalize_currency(idx_currency >= 0 && idx_currency < field_count ? fields[idx_currency] : "", code);
+      if (code[0] == '\0' || strcmp(code, opts->fx->report_currency) == 0) {
+        ledger->fx_native++;
+      } else {
+        if (!last_series || strcmp(last_series->code, code) != 0) {
+          last_series = fx_table_find(opts->fx, code);
+        }
+        if (!last_series) {
+          ledger->fx_unknown++;
+          ledger->fx_missing++;
+          ledger->skipped++;
+          continue;
+        }
+        double rate = fx_series_lookup(last_series, date_key);
+        if (rate <= 0.0) {
+          last_series->missing++;
+          ledger->fx_missing++;
+          ledger->skipped++;
+          continue;
+        }
+        last_series->rows++;
+        last_series->native_total += amount;
+        amount *= rate;
+        last_series->converted_total += amount;
+        ledger->fx_converted++;
+        currency = last_series->code;
+      }
+    } else if (idx_currency >= 0 && idx_currency < field_count && opts->report_currency) {
+      char code[8];
+      normalize_currency(fields[idx_currency], code);
+      if (code[0] != '\0' && strcmp(code, opts->report_currency) != 0) {
+        ledger->fx_unconverted++;
+      }
+    }
+
+    if (opts->dedupe) {
+      uint64_t lanes[2] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL};
+      fingerprint_u64(lanes, (uint64_t)date_key);
+      fingerprint_field(lanes, currency, 0);
+      fingerprint_u64(lanes, (uint64_t)llround(amount * 100.0) * 2 + (uint64_t)is_inflow);
+      fingerprint_field(lanes, category, 1);
+      fingerprint_field(lanes, idx_reference >= 0 && idx_reference < field_count ? fields[idx_reference] : "", 0);
+      if (!fingerprint_set_insert(&seen, mix64(lanes[0]), mix64(lanes[1] ^ lanes[0]))) {
+        ledger->duplicates++;
+        if (is_inflow) {
+          ledger->duplicate_inflow += amount;
+        } else {
+          ledger->duplicate_outflow += amount;
+        }
+        continue;
+      }
+    }
+
+    ledger->record_count++;
+
+    if (is_inflow) {
+      ledger->total_inflow += amount;
+      month_list_add(&ledger->months, month, amount, 0.0);
+      category_list_add(&ledger->inflow_categories, category, amount, month_key);
+    } else {
+      ledger->total_outflow += amount;
+      month_list_add(&ledger->months, month, 0.0, amount);
+      category_list_add(&ledger->categories, category, amount, month_key);
+      largest_push(ledger->largest, &ledger->largest_count, date_key, category, amount);
+      if (restricted) {
+        ledger->total_restricted += amount;
+      }
+    }
+  }
+
+  fclose(fp);
+  free(sample);
+  ledger->dedupe_unique = seen.count;
+  ledger->dedupe_bytes = seen.cap * 2 * sizeof(uint64_t);
+  free(seen.slots);
+  if (ledger->fx_missing > 0) {
+    fprintf(stderr, "Warning: skipped %zu rows with no FX rate on or before their date (%zu in unrated currencies).\n",
+            ledger->fx_missing, ledger->fx_unknown);
+  }
+  if (ledger->fx_unconverted > 0) {
+    fprintf(stderr, "Warning: %zu rows are not in %s and no --fx-rates table was given; summed unconverted.\n",
+            ledger->fx_unconverted, opts->report_currency);
+  }
+
+  category_list_finish(&ledger->categories);
+  category_list_finish(&ledger->inflow_categories);
+  qsort(ledger->months.items, ledger->months.count, sizeof(MonthStat), compare_months);
+  qsort(ledger->categories.items, ledger->categories.count, sizeof(CategoryStat), compare_categories);
+  qsort(ledger->inflow_categories.items, ledger->inflow_categories.count, sizeof(CategoryStat), compare_categories);
+  for (size_t i = 0; i < ledger->categories.count; i++) {
+    tdigest_merge(&ledger->outflow_digest, &ledger->categories.items[i].digest);
+  }
+  for (size_t i = 0; i < ledger->inflow_categories.count; i++) {
+    tdigest_merge(&ledger->inflow_digest, &ledger->inflow_categories.items[i].digest);
+  }
+  tdigest_merge(&ledger->outflow_digest, &ledger->categories.evicted_digest);
+  tdigest_merge(&ledger->inflow_digest, &ledger->inflow_categories.evicted_digest);
+  qsort(ledger->largest, ledger->largest_count, sizeof(Entry), compare_entries_desc);
+  return 0;
+}
+
+/* Number of sorted months at or before as_of (all months when as_of is empty). */
+static size_t month_upper_bound(const MonthStat *items, size_t count, const char *as_of) {
+  if (as_of[0] == '\0') {
+    return count;
+  }
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (strcmp(items[mid].month, as_of) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/*
+ * Derives every month-level metric from sorted month aggregates. month_net and
+ * month_balance are optional per-month outputs; batch queries pass NULL so each
+ * answer stays allocation-free.
+ */
+static void compute_summary(const MonthStat *items, size_t count, const RunwayParams *params,
+                            RunwaySummary *s, double *month_net, double *month_balance) {
+  memset(s, 0, sizeof(*s));
+  s->month_count = count;
+  s->available_cash = params->starting_cash - params->reserved_cash;
+  if (s->available_cash < 0) s->available_cash = 0.0;
+  s->ending_cash = s->available_cash;
+  s->lowest_balance = s->available_cash;
+  s->depletion_index = -1;
+
+  double balance = s->available_cash;
+  double prev_net = 0.0;
+  int current_deficit_streak = 0;
+  char current_deficit_start[8] = "";
+  for (size_t i = 0; i < count; i++) {
+    double net = items[i].inflow - items[i].outflow;
+    s->total_inflow += items[i].inflow;
+    s->total_outflow += items[i].outflow;
+    balance += net;
+    if (month_net) month_net[i] = net;
+    if (month_balance) month_balance[i] = balance;
+    if (i == 0 || net > s->best_net) {
+      s->best_net = net;
+      copy_month(s->best_net_month, items[i].month);
+    }
+    if (i == 0 || net < s->worst_net) {
+      s->worst_net = net;
+      copy_month(s->worst_net_month, items[i].month);
+    }
+    if (net < 0) {
+      s->deficit_months++;
+      if (current_deficit_streak == 0) {
+        copy_month(current_deficit_start, items[i].month);
+      }
+      current_deficit_streak++;
+      if (current_deficit_streak > s->longest_deficit_streak) {
+        s->longest_deficit_streak = current_deficit_streak;
+        copy_month(s->longest_deficit_start, current_deficit_start);
+        copy_month(s->longest_deficit_end, items[i].month);
+      }
+    } else {
+      current_deficit_streak = 0;
+      current_deficit_start[0] = '\0';
+    }
+    if (i == 0 || balance < s->lowest_balance) {
+      s->lowest_balance = balance;
+      copy_month(s->lowest_balance_month, items[i].month);
+    }
+    if (s->depletion_index == -1 && balance <= 0.0) {
+      s->depletion_index = (int)i;
+      s->depletion_balance = balance;
+      copy_month(s->depletion_month, items[i].month);
+    }
+    if (i == 0 || items[i].inflow > s->peak_inflow) {
+      s->peak_inflow = items[i].inflow;
+      copy_month(s->peak_inflow_month, items[i].month);
+    }
+    if (i == 0 || items[i].outflow > s->peak_outflow) {
+      s->peak_outflow = items[i].outflow;
+      copy_month(s->peak_outflow_month, items[i].month);
+    }
+    if (i > 0) {
+      double delta = net - prev_net;
+      double delta_abs = fabs(delta);
+      if (delta_abs > s->largest_net_swing_abs) {
+        s->largest_net_swing_abs = delta_abs;
+        s->largest_net_swing_delta = delta;
+        copy_month(s->largest_net_swing_month, items[i].month);
+      }
+    }
+    prev_net = net;
+  }
+  if (count > 0) {
+    s->ending_cash = balance;
+  }
+
+  if (params->window_months > 0 && count > (size_t)params->window_months) {
+    s->month_start = count - (size_t)params->window_months;
+  }
+
+  double burn_total = 0.0;
+  double net_total = 0.0;
+  double inflow_total = 0.0;
+  double outflow_total = 0.0;
+  for (size_t i = s->month_start; i < count; i++) {
+    double net = items[i].inflow - items[i].outflow;
+    net_total += net;
+    inflow_total += items[i].inflow;
+    outflow_total += items[i].outflow;
+    s->net_count++;
+    if (net < 0) {
+      burn_total += -net;
+      s->burn_count++;
+    }
+  }
+
+  s->avg_burn = s->burn_count > 0 ? burn_total / s->burn_count : 0.0;
+  s->avg_net = s->net_count > 0 ? net_total / s->net_count : 0.0;
+  s->avg_inflow = s->net_count > 0 ? inflow_total / s->net_count : 0.0;
+  s->avg_outflow = s->net_count > 0 ? outflow_total / s->net_count : 0.0;
+  s->outflow_coverage = s->avg_outflow > 0 ? s->available_cash / s->avg_outflow : 0.0;
+  if (s->avg_outflow > s->avg_inflow) {
+    s->breakeven_gap = s->avg_outflow - s->avg_inflow;
+    if (s->avg_inflow > 0) {
+      s->breakeven_inflow_pct = (s->breakeven_gap / s->avg_inflow) * 100.0;
+    }
+    if (s->avg_outflow > 0) {
+      s->breakeven_outflow_pct = (s->breakeven_gap / s->avg_outflow) * 100.0;
+    }
+  }
+  double net_variance_sum = 0.0;
+  for (size_t i = s->month_start; i < count; i++) {
+    double diff = (items[i].inflow - items[i].outflow) - s->avg_net;
+    net_variance_sum += diff * diff;
+  }
+  s->net_volatility = s->net_count > 0 ? sqrt(net_variance_sum / s->net_count) : 0.0;
+  s->runway_months = s->avg_burn > 0 ? s->available_cash / s->avg_burn : 0.0;
+  s->risk_level = "not_at_risk";
+  if (s->avg_burn > 0) {
+    s->risk_level = risk_from_runway(s->runway_months);
+  }
+  s->target_runway_months = 12.0;
+  s->target_cash = s->avg_burn > 0 ? s->avg_burn * s->target_runway_months : 0.0;
+  s->funding_gap = s->target_cash > s->available_cash ? s->target_cash - s->available_cash : 0.0;
+
+  s->trend_window = 3;
+  s->recent_start = count > s->trend_window ? count - s->trend_window : 0;
+  s->recent_count = count - s->recent_start;
+  double recent_net_total = 0.0;
+  for (size_t i = s->recent_start; i < count; i++) {
+    recent_net_total += items[i].inflow - items[i].outflow;
+  }
+  s->recent_avg_net = s->recent_count > 0 ? recent_net_total / (double)s->recent_count : 0.0;
+  size_t prior_end = s->recent_start;
+  size_t prior_start = prior_end > s->trend_window ? prior_end - s->trend_window : 0;
+  s->prior_count = prior_end - prior_start;
+  double prior_net_total = 0.0;
+  for (size_t i = prior_start; i < prior_end; i++) {
+    prior_net_total += items[i].inflow - items[i].outflow;
+  }
+  s->prior_avg_net = s->prior_count > 0 ? prior_net_total / (double)s->prior_count : 0.0;
+  s->net_trend_delta = s->recent_avg_net - s->prior_avg_net;
+}
+
+static const char *project_scenario(const Scenario *scenario, const RunwaySummary *s, double *net, double *runway) {
+  double scenario_inflow = s->avg_inflow * (1.0 + scenario->inflow_adj);
+  double scenario_outflow = s->avg_outflow * (1.0 + scenario->outflow_adj);
+  *net = scenario_inflow - scenario_outflow;
+  *runway = *net < 0 ? s->available_cash / (-*net) : 0.0;
+  return *net < 0 ? risk_from_runway(*runway) : "not_at_risk";
+}
+
+/*
+ * The category x month cube is the CategoryStat month series of both
+ * directions: one sorted CategoryMonth cell per non-empty (category, month),
+ * so it costs 16 bytes per cell. MonthTotals gives the dense per-month
+ * direction totals over the ledger's month range that turn cells into shares.
+ */
+typedef struct {
+  int first_key;
+  size_t span;
+  double *inflow;
+  double *outflow;
+} MonthTotals;
+
+typedef struct {
+  size_t active_months;
+  double slope;
+  double share_slope;
+  int peak_key;
+  double peak_amount;
+} CategoryTrend;
+
+static void month_totals_build(const MonthList *months, MonthTotals *totals) {
+  memset(totals, 0, sizeof(*totals));
+  if (months->count == 0) {
+    return;
+  }
+  totals->first_key = month_key_from(months->items[0].month);
+  totals->span = (size_t)(month_key_from(months->items[months->count - 1].month) - totals->first_key + 1);
+  totals->inflow = calloc(totals->span, sizeof(double));
+  totals->outflow = calloc(totals->span, sizeof(double));
+  if (!totals->inflow || !totals->outflow) {
+    fprintf(stderr, "Memory allocation failed for month totals.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < months->count; i++) {
+    size_t slot = (size_t)(month_key_from(months->items[i].month) - totals->first_key);
+    totals->inflow[slot] = months->items[i].inflow;
+    totals->outflow[slot] = months->items[i].outflow;
+  }
+}
+
+static void month_totals_free(MonthTotals *totals) {
+  free(totals->inflow);
+  free(totals->outflow);
+  memset(totals, 0, sizeof(*totals));
+}
+
+static double cell_share_pct(const MonthTotals *totals, const double *direction_totals, const CategoryMonth *cell) {
+  double total = direction_totals[cell->month_key - totals->first_key];
+  return total > 0 ? cell->amount / total * 100.0 : 0.0;
+}
+
+/*
+ * Least-squares slopes of monthly amount and share (percentage points) over
+ * the whole month range, with empty months counted as zero. The x sums have
+ * closed forms, so only non-empty cells are visited.
+ */
+static void category_trend(const CategoryStat *stat, const MonthTotals *totals, const double *direction_totals,
+                           CategoryTrend *trend) {
+  memset(trend, 0, sizeof(*trend));
+  trend->active_months = stat->month_count;
+  double n = (double)totals->span;
+  double sum_y = 0.0, sum_xy = 0.0, sum_share = 0.0, sum_x_share = 0.0;
+  for (size_t i = 0; i < stat->month_count; i++) {
+    const CategoryMonth *cell = &stat->months[i];
+    double x = (double)(cell->month_key - totals->first_key);
+    double share = cell_share_pct(totals, direction_totals, cell);
+    sum_y += cell->amount;
+    sum_xy += x * cell->amount;
+    sum_share += share;
+    sum_x_share += x * share;
+    if (i == 0 || cell->amount > trend->peak_amount) {
+      trend->peak_amount = cell->amount;
+      trend->peak_key = cell->month_key;
+    }
+  }
+  if (totals->span < 2) {
+    return;
+  }
+  double sum_x = n * (n - 1.0) / 2.0;
+  double sum_xx = (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+  double denom = n * sum_xx - sum_x * sum_x;
+  trend->slope = (n * sum_xy - sum_x * sum_y) / denom;
+  trend->share_slope = (n * sum_x_share - sum_x * sum_share) / denom;
+}
+
+static size_t cube_cell_count(const CategoryList *list) {
+  size_t cells = 0;
+  for (size_t i = 0; i < list->count; i++) {
+    cells += list->items[i].month_count;
+  }
+  return cells;
+}
+
+static void write_cube_json(FILE *out, const char *direction, const CategoryList *list, const MonthTotals *totals,
+                            const double *direction_totals, int last) {
+  fprintf(out, "    \"%s\": [\n", direction);
+  for (size_t c = 0; c < list->count; c++) {
+    const CategoryStat *stat = &list->items[c];
+    CategoryTrend trend;
+    category_trend(stat, totals, direction_totals, &trend);
+    char month[8];
+    month_from_key(trend.peak_key, month);
+    fprintf(out, "      {\"category\": ");
+    fprint_json_string(out, stat->name);
+    fprintf(out,
+            ", \"total\": %.2f, \"active_months\": %zu, \"trend_slope\": %.2f, \"share_slope_pct\": %.4f, "
+            "\"peak_month\": \"%s\", \"peak_amount\": %.2f, \"approximate\": %s, \"months\": [",
+            stat->outflow, trend.active_months, trend.slope, trend.share_slope, month, trend.peak_amount,
+            stat->error > 0 ? "true" : "false");
+    for (size_t i = 0; i < stat->month_count; i++) {
+      const CategoryMonth *cell = &stat->months[i];
+      month_from_key(cell->month_key, month);
+      fprintf(out, "%s{\"month\": \"%s\", \"amount\": %.2f, \"share_pct\": %.2f}", i > 0 ? ", " : "", month,
+              cell->amount, cell_share_pct(totals, direction_totals, cell));
+    }
+    fprintf(out, "]}%s\n", c + 1 < list->count ? "," : "");
+  }
+  fprintf(out, "    ]%s\n", last ? "" : ",");
+}
+
+/*
+ * Minimal Arrow IPC file writer (format version V5, little-endian hosts).
+ * Flatbuffers are laid out front to back: every table is written before the
+ * strings, vectors and tables it references, so all uoffsets point forward
+ * and are patched once the child position is known.
+ */
+typedef enum { ARROW_UTF8, ARROW_FLOAT64, ARROW_INT64 } ArrowType;
+
+typedef struct {
+  const char *name;
+  ArrowType type;
+  const char *const *strings;
+  const double *doubles;
+  const int64_t *ints;
+} ArrowColumn;
+
+typedef struct {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+} ByteBuf;
+
+typedef struct {
+  uint8_t size;
+  uint64_t value;
+} FbSlot;
+
+static size_t bb_put(ByteBuf *b, const void *src, size_t n) {
+  if (b->len + n > b->cap) {
+    size_t next_cap = b->cap == 0 ? 1024 : b->cap;
+    while (next_cap < b->len + n) next_cap *= 2;
+    unsigned char *next = realloc(b->data, next_cap);
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+      exit(1);
+    }
+    b->data = next;
+    b->cap = next_cap;
+  }
+  size_t pos = b->len;
+  if (src) {
+    memcpy(b->data + pos, src, n);
+  } else {
+    memset(b->data + pos, 0, n);
+  }
+  b->len += n;
+  return pos;
+}
+
+static void bb_pad(ByteBuf *b, size_t align) {
+  size_t rem = b->len % align;
+  if (rem) bb_put(b, NULL, align - rem);
+}
+
+static void fb_link(ByteBuf *b, size_t at, size_t target) {
+  uint32_t rel = (uint32_t)(target - at);
+  memcpy(b->data + at, &rel, sizeof(rel));
+}
+
+/* Writes a vtable followed by its table; slot_pos receives each present field's position. */
+static size_t fb_table(ByteBuf *b, const FbSlot *slots, int n, size_t *slot_pos) {
+  uint16_t vtable[2 + 8];
+  size_t off = 4;
+  for (int i = 0; i < n; i++) {
+    if (slots[i].size == 0) {
+      vtable[2 + i] = 0;
+      continue;
+    }
+    off = (off + slots[i].size - 1) / slots[i].size * slots[i].size;
+    vtable[2 + i] = (uint16_t)off;
+    off += slots[i].size;
+  }
+  vtable[0] = (uint16_t)((2 + n) * sizeof(uint16_t));
+  vtable[1] = (uint16_t)off;
+  bb_pad(b, 2);
+  size_t vtable_pos = bb_put(b, vtable, vtable[0]);
+  bb_pad(b, 8);
+  size_t table_pos = bb_put(b, NULL, off);
+  int32_t soffset = (int32_t)(table_pos - vtable_pos);
+  memcpy(b->data + table_pos, &soffset, sizeof(soffset));
+  for (int i = 0; i < n; i++) {
+    if (slots[i].size == 0) continue;
+    size_t pos = table_pos + vtable[2 + i];
+    memcpy(b->data + pos, &slots[i].value, slots[i].size);
+    if (slot_pos) slot_pos[i] = pos;
+  }
+  return table_pos;
+}
+
+static size_t fb_string(ByteBuf *b, const char *value) {
+  uint32_t len = (uint32_t)strlen(value);
+  bb_pad(b, 4);
+  size_t pos = bb_put(b, &len, sizeof(len));
+  bb_put(b, value, len + 1);
+  return pos;
+}
+
+/* Vector of uoffsets; element i lives at the returned position + 4 + 4 * i. */
+static size_t fb_offset_vector(ByteBuf *b, uint32_t count) {
+  bb_pad(b, 4);
+  size_t pos = bb_put(b, &count, sizeof(count));
+  bb_put(b, NULL, (size_t)count * 4);
+  return pos;
+}
+
+/* Vector of 8-byte-aligned structs (FieldNode, Buffer, Block). */
+static size_t fb_struct_vector(ByteBuf *b, const void *items, uint32_t count, size_t item_size) {
+  bb_pad(b, 4);
+  if ((b->len + 4) % 8 != 0) bb_put(b, NULL, 4);
+  size_t pos = bb_put(b, &count, sizeof(count));
+  bb_put(b, items, (size_t)count * item_size);
+  return pos;
+}
+
+static size_t fb_field(ByteBuf *b, const ArrowColumn *column) {
+  uint8_t type_id = column->type == ARROW_UTF8 ? 5 : column->type == ARROW_FLOAT64 ? 3 : 2;
+  FbSlot slots[6] = {{4, 0}, {1, 0}, {1, type_id}, {4, 0}, {0, 0}, {4, 0}};
+  size_t pos[6];
+  size_t field = fb_table(b, slots, 6, pos);
+  fb_link(b, pos[0], fb_string(b, column->name));
+  size_t type;
+  if (column->type == ARROW_UTF8) {
+    type = fb_table(b, NULL, 0, NULL);
+  } else if (column->type == ARROW_FLOAT64) {
+    FbSlot precision[1] = {{2, 2}};
+    type = fb_table(b, precision, 1, NULL);
+  } else {
+    FbSlot int_type[2] = {{4, 64}, {1, 1}};
+    type = fb_table(b, int_type, 2, NULL);
+  }
+  fb_link(b, pos[3], type);
+  fb_link(b, pos[5], fb_offset_vector(b, 0));
+  return field;
+}
+
+static size_t fb_schema(ByteBuf *b, const ArrowColumn *columns, size_t column_count) {
+  FbSlot slots[2] = {{2, 0}, {4, 0}};
+  size_t pos[2];
+  size_t schema = fb_table(b, slots, 2, pos);
+  size_t fields = fb_offset_vector(b, (uint32_t)column_count);
+  fb_link(b, pos[1], fields);
+  for (size_t i = 0; i < column_count; i++) {
+    fb_link(b, fields + 4 + 4 * i, fb_field(b, &columns[i]));
+  }
+  return schema;
+}
+
+/* Starts a Message flatbuffer; returns the header slot position to link. */
+static size_t fb_message(ByteBuf *b, uint8_t header_type, int64_t body_length) {
+  uint32_t root = 0;
+  bb_put(b, &root, sizeof(root));
+  FbSlot slots[4] = {{2, 4}, {1, header_type}, {4, 0}, {8, (uint64_t)body_length}};
+  size_t pos[4];
+  fb_link(b, 0, fb_table(b, slots, 4, pos));
+  return pos[2];
+}
+
+/* Writes continuation marker, metadata length, padded flatbuffer and body; returns bytes written. */
+static size_t write_ipc_message(FILE *out, ByteBuf *meta, const ByteBuf *body, int32_t *meta_length) {
+  bb_pad(meta, 8);
+  uint32_t prefix[2] = {0xFFFFFFFFu, (uint32_t)meta->len};
+  fwrite(prefix, sizeof(prefix), 1, out);
+  fwrite(meta->data, 1, meta->len, out);
+  if (body && body->len) {
+    fwrite(body->data, 1, body->len, out);
+  }
+  *meta_length = (int32_t)(sizeof(prefix) + meta->len);
+  return sizeof(prefix) + meta->len + (body ? body->len : 0);
+}
+
+static void arrow_body_buffer(ByteBuf *body, int64_t *buffers, size_t *buffer_count, const void *data, size_t n) {
+  buffers[*buffer_count * 2] = (int64_t)body->len;
+  buffers[*buffer_count * 2 + 1] = (int64_t)n;
+  (*buffer_count)++;
+  if (n) bb_put(body, data, n);
+  bb_pad(body, 8);
+}
+
+/* Writes one non-nullable table as a single-batch Arrow IPC file. */
+static int write_arrow_file(const char *path, const ArrowColumn *columns, size_t column_count, size_t rows) {
+  FILE *out = fopen(path, "wb");
+  if (!out) {
+    fprintf(stderr, "Failed to write Arrow file %s\n", path);
+    return 1;
+  }
+  size_t file_pos = 0;
+  file_pos += fwrite("ARROW1\0\0", 1, 8, out);
+
+  ByteBuf meta = {0};
+  int32_t meta_length = 0;
+  fb_link(&meta, fb_message(&meta, 1, 0), fb_schema(&meta, columns, column_count));
+  file_pos += write_ipc_message(out, &meta, NULL, &meta_length);
+
+  ByteBuf body = {0};
+  int64_t *nodes = calloc(column_count * 2, sizeof(int64_t));
+  int64_t *buffers = calloc(column_count * 3 * 2, sizeof(int64_t));
+  int32_t *offsets = calloc(rows + 1, sizeof(int32_t));
+  if (!nodes || !buffers || !offsets) {
+    fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+    exit(1);
+  }
+  size_t buffer_count = 0;
+  for (size_t c = 0; c < column_count; c++) {
+    nodes[c * 2] = (int64_t)rows;
+    nodes[c * 2 + 1] = 0;
+    arrow_body_buffer(&body, buffers, &buffer_count, NULL, 0);
+    if (columns[c].type == ARROW_UTF8) {
+      int32_t total = 0;
+      for (size_t r = 0; r < rows; r++) {
+        offsets[r] = total;
+        total += (int32_t)strlen(columns[c].strings[r]);
+      }
+      offsets[rows] = total;
+      arrow_body_buffer(&body, buffers, &buffer_count, offsets, (rows + 1) * sizeof(int32_t));
+      buffers[buffer_count * 2] = (int64_t)body.len;
+      buffers[buffer_count * 2 + 1] = total;
+      buffer_count++;
+      for (size_t r = 0; r < rows; r++) {
+        bb_put(&body, columns[c].strings[r], strlen(columns[c].strings[r]));
+      }
+      bb_pad(&body, 8);
+    } else if (columns[c].type == ARROW_FLOAT64) {
+      arrow_body_buffer(&body, buffers, &buffer_count, columns[c].doubles, rows * sizeof(double));
+    } else {
+      arrow_body_buffer(&body, buffers, &buffer_count, columns[c].ints, rows * sizeof(int64_t));
+    }
+  }
+
+  meta.len = 0;
+  size_t header_slot = fb_message(&meta, 3, (int64_t)body.len);
+  FbSlot batch_slots[3] = {{8, (uint64_t)rows}, {4, 0}, {4, 0}};
+  size_t batch_pos[3];
+  fb_link(&meta, header_slot, fb_table(&meta, batch_slots, 3, batch_pos));
+  fb_link(&meta, batch_pos[1], fb_struct_vector(&meta, nodes, (uint32_t)column_count, 16));
+  fb_link(&meta, batch_pos[2], fb_struct_vector(&meta, buffers, (uint32_t)buffer_count, 16));
+  int64_t block[3] = {(int64_t)file_pos, 0, (int64_t)body.len};
+  file_pos += write_ipc_message(out, &meta, &body, &meta_length);
+  block[1] = meta_length;
+
+  uint32_t eos[2] = {0xFFFFFFFFu, 0};
+  fwrite(eos, sizeof(eos), 1, out);
+
+  meta.len = 0;
+  uint32_t root = 0;
+  bb_put(&meta, &root, sizeof(root));
+  FbSlot footer_slots[4] = {{2, 4}, {4, 0}, {4, 0}, {4, 0}};
+  size_t footer_pos[4];
+  fb_link(&meta, 0, fb_table(&meta, footer_slots, 4, footer_pos));
+  fb_link(&meta, footer_pos[1], fb_schema(&meta, columns, column_count));
+  fb_link(&meta, footer_pos[2], fb_struct_vector(&meta, NULL, 0, 24));
+  fb_link(&meta, footer_pos[3], fb_struct_vector(&meta, block, 1, 24));
+  bb_pad(&meta, 8);
+  int32_t footer_length = (int32_t)meta.len;
+  fwrite(meta.data, 1, meta.len, out);
+  fwrite(&footer_length, sizeof(footer_length), 1, out);
+  fwrite("ARROW1", 1, 6, out);
+
+  free(meta.data);
+  free(body.data);
+  free(nodes);
+  free(buffers);
+  free(offsets);
+  if (fclose(out) != 0) {
+    fprintf(stderr, "Failed to write Arrow file %s\n", path);
+    return 1;
+  }
+  return 0;
+}
+
+static int join_path(char *dst, size_t dst_len, const char *dir, const char *name) {
+  int written = snprintf(dst, dst_len, "%s/%s", dir, name);
+  return written > 0 && (size_t)written < dst_len;
+}
+
+static int write_arrow_categories(const char *path, CategoryList *outflow, double total_outflow,
+                                  CategoryList *inflow, double total_inflow, const MonthTotals *totals) {
+  size_t rows = outflow->count + inflow->count;
+  const char **names = calloc(rows + 1, sizeof(char *));
+  const char **directions = calloc(rows + 1, sizeof(char *));
+  double *amounts = calloc(rows + 1, sizeof(double));
+  double *shares = calloc(rows + 1, sizeof(double));
+  int64_t *counts = calloc(rows + 1, sizeof(int64_t));
+  double *quantiles = calloc((rows + 1) * 3, sizeof(double));
+  double *trends = calloc((rows + 1) * 2, sizeof(double));
+  if (!names || !directions || !amounts || !shares || !counts || !quantiles || !trends) {
+    fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+    exit(1);
+  }
+  size_t r = 0;
+  for (size_t i = 0; i < rows; i++) {
+    TDigest *digest = i < outflow->count ? &outflow->items[i].digest : &inflow->items[i - outflow->count].digest;
+    quantiles[i] = tdigest_quantile(digest, 0.5);
+    quantiles[rows + i] = tdigest_quantile(digest, 0.9);
+    quantiles[rows * 2 + i] = tdigest_quantile(digest, 0.99);
+    CategoryTrend trend;
+    if (i < outflow->count) {
+      category_trend(&outflow->items[i], totals, totals->outflow, &trend);
+    } else {
+      category_trend(&inflow->items[i - outflow->count], totals, totals->inflow, &trend);
+    }
+    trends[i] = trend.slope;
+    trends[rows + i] = trend.share_slope;
+  }
+  for (size_t i = 0; i < outflow->count; i++, r++) {
+    names[r] = outflow->items[i].name;
+    directions[r] = "outflow";
+    amounts[r] = outflow->items[i].outflow;
+    shares[r] = total_outflow > 0 ? outflow->items[i].outflow / total_outflow * 100.0 : 0.0;
+    counts[r] = outflow->items[i].count;
+  }
+  for (size_t i = 0; i < inflow->count; i++, r++) {
+    names[r] = inflow->items[i].name;
+    directions[r] = "inflow";
+    amounts[r] = inflow->items[i].outflow;
+    shares[r] = total_inflow > 0 ? inflow->items[i].outflow / total_inflow * 100.0 : 0.0;
+    counts[r] = inflow->items[i].count;
+  }
+  ArrowColumn columns[] = {
+      {"category", ARROW_UTF8, names, NULL, NULL},
+      {"direction", ARROW_UTF8, directions, NULL, NULL},
+      {"amount", ARROW_FLOAT64, NULL, amounts, NULL},
+      {"count", ARROW_INT64, NULL, NULL, counts},
+      {"share_pct", ARROW_FLOAT64, NULL, shares, NULL},
+      {"median", ARROW_FLOAT64, NULL, quantiles, NULL},
+      {"p90", ARROW_FLOAT64, NULL, quantiles + rows, NULL},
+      {"p99", ARROW_FLOAT64, NULL, quantiles + rows * 2, NULL},
+      {"trend_slope", ARROW_FLOAT64, NULL, trends, NULL},
+      {"share_slope_pct", ARROW_FLOAT64, NULL, trends + rows, NULL},
+  };
+  int status = write_arrow_file(path, columns, sizeof(columns) / sizeof(columns[0]), rows);
+  free(names);
+  free(directions);
+  free(amounts);
+  free(shares);
+  free(counts);
+  free(quantiles);
+  free(trends);
+  return status;
+}
+
+/* Long-format cube: one row per non-empty (direction, category, month) cell. */
+static int write_arrow_category_months(const char *path, const Ledger *ledger, const MonthTotals *totals) {
+  size_t rows = cube_cell_count(&ledger->categories) + cube_cell_count(&ledger->inflow_categories);
+  const char **names = calloc(rows + 1, sizeof(char *));
+  const char **directions = calloc(rows + 1, sizeof(char *));
+  char (*month_text)[8] = calloc(rows + 1, sizeof(*month_text));
+  const char **months = calloc(rows + 1, sizeof(char *));
+  double *values = calloc((rows + 1) * 2, sizeof(double));
+  if (!names || !directions || !month_text || !months || !values) {
+    fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+    exit(1);
+  }
+  size_t r = 0;
+  for (int d = 0; d < 2; d++) {
+    const CategoryList *list = d == 0 ? &ledger->categories : &ledger->inflow_categories;
+    const double *direction_totals = d == 0 ? totals->outflow : totals->inflow;
+    for (size_t c = 0; c < list->count; c++) {
+      const CategoryStat *stat = &list->items[c];
+      for (size_t i = 0; i < stat->month_count; i++, r++) {
+        names[r] = stat->name;
+        directions[r] = d == 0 ? "outflow" : "inflow";
+        month_from_key(stat->months[i].month_key, month_text[r]);
+        months[r] = month_text[r];
+        values[r] = stat->months[i].amount;
+        values[rows + r] = cell_share_pct(totals, direction_totals, &stat->months[i]);
+      }
+    }
+  }
+  ArrowColumn columns[] = {
+      {"category", ARROW_UTF8, names, NULL, NULL},
+      {"direction", ARROW_UTF8, directions, NULL, NULL},
+      {"month", ARROW_UTF8, months, NULL, NULL},
+      {"amount", ARROW_FLOAT64, NULL, values, NULL},
+      {"share_pct", ARROW_FLOAT64, NULL, values + rows, NULL},
+  };
+  int status = write_arrow_file(path, columns, sizeof(columns) / sizeof(columns[0]), rows);
+  free(names);
+  free(directions);
+  free(month_text);
+  free(months);
+  free(values);
+  return status;
+}
+
+/* Writes months.arrow, categories.arrow, category_months.arrow and scenarios.arrow into dir. */
+static int write_arrow_report(const char *dir, Ledger *ledger, const RunwaySummary *s,
+                              const double *month_net, const double *month_balance,
+                              const Scenario *scenarios, size_t scenario_count) {
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Failed to create Arrow directory %s\n", dir);
+    return 1;
+  }
+  char path[4096];
+  int status = 0;
+
+  const MonthList *months = &ledger->months;
+  const char **month_names = calloc(months->count + 1, sizeof(char *));
+  double *inflow = calloc(months->count + 1, sizeof(double));
+  double *outflow = calloc(months->count + 1, sizeof(double));
+  if (!month_names || !inflow || !outflow) {
+    fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < months->count; i++) {
+    month_names[i] = months->items[i].month;
+    inflow[i] = months->items[i].inflow;
+    outflow[i] = months->items[i].outflow;
+  }
+  ArrowColumn month_columns[] = {
+      {"month", ARROW_UTF8, month_names, NULL, NULL},
+      {"inflow", ARROW_FLOAT64, NULL, inflow, NULL},
+      {"outflow", ARROW_FLOAT64, NULL, outflow, NULL},
+      {"net", ARROW_FLOAT64, NULL, month_net, NULL},
+      {"balance", ARROW_FLOAT64, NULL, month_balance, NULL},
+  };
+  if (!join_path(path, sizeof(path), dir, "months.arrow") ||
+      write_arrow_file(path, month_columns, sizeof(month_columns) / sizeof(month_columns[0]), months->count) != 0) {
+    status = 1;
+  }
+  free(month_names);
+  free(inflow);
+  free(outflow);
+
+  MonthTotals totals;
+  month_totals_build(months, &totals);
+  if (status == 0 && (!join_path(path, sizeof(path), dir, "categories.arrow") ||
+                      write_arrow_categories(path, &ledger->categories, ledger->total_outflow,
+                                             &ledger->inflow_categories, ledger->total_inflow, &totals) != 0)) {
+    status = 1;
+  }
+  if (status == 0 && (!join_path(path, sizeof(path), dir, "category_months.arrow") ||
+                      write_arrow_category_months(path, ledger, &totals) != 0)) {
+    status = 1;
+  }
+  month_totals_free(&totals);
+
+  const char **names = calloc(scenario_count, sizeof(char *));
+  const char **risks = calloc(scenario_count, sizeof(char *));
+  double *values = calloc(scenario_count * 4, sizeof(double));
+  if (!names || !risks || !values) {
+    fprintf(stderr, "Memory allocation failed for Arrow output.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < scenario_count; i++) {
+    names[i] = scenarios[i].name;
+    values[i] = scenarios[i].inflow_adj * 100.0;
+    values[scenario_count + i] = scenarios[i].outflow_adj * 100.0;
+    risks[i] = project_scenario(&scenarios[i], s, &values[scenario_count * 2 + i], &values[scenario_count * 3 + i]);
+  }
+  ArrowColumn scenario_columns[] = {
+      {"name", ARROW_UTF8, names, NULL, NULL},
+      {"inflow_adj_pct", ARROW_FLOAT64, NULL, values, NULL},
+      {"outflow_adj_pct", ARROW_FLOAT64, NULL, values + scenario_count, NULL},
+      {"projected_net", ARROW_FLOAT64, NULL, values + scenario_count * 2, NULL},
+      {"projected_runway_months", ARROW_FLOAT64, NULL, values + scenario_count * 3, NULL},
+      {"risk", ARROW_UTF8, risks, NULL, NULL},
+  };
+  if (status == 0 && (!join_path(path, sizeof(path), dir, "scenarios.arrow") ||
+                      write_arrow_file(path, scenario_columns, sizeof(scenario_columns) / sizeof(scenario_columns[0]),
+                                       scenario_count) != 0)) {
+    status = 1;
+  }
+  free(names);
+  free(risks);
+  free(values);
+  return status;
+}
+
+static void anomaly_list_add(AnomalyList *list, const char *category, const char *direction, int month_key,
+                             const char *kind, double amount, double mean, double std_dev, double z) {
+  if (list->count == list->cap) {
+    size_t next_cap = list->cap == 0 ? 16 : list->cap * 2;
+    Anomaly *next = realloc(list->items, next_cap * sizeof(Anomaly));
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for anomalies.\n");
+      exit(1);
+    }
+    list->items = next;
+    list->cap = next_cap;
+  }
+  Anomaly *item = &list->items[list->count++];
+  item->category = category;
+  item->direction = direction;
+  item->month_key = month_key;
+  item->kind = kind;
+  item->amount = amount;
+  item->mean = mean;
+  item->std_dev = std_dev;
+  item->z = z;
+}
+
+static int compare_anomalies(const void *a, const void *b) {
+  const Anomaly *aa = (const Anomaly *)a;
+  const Anomaly *ab = (const Anomaly *)b;
+  if (aa->month_key != ab->month_key) return aa->month_key < ab->month_key ? -1 : 1;
+  double za = fabs(aa->z);
+  double zb = fabs(ab->z);
+  return (zb > za) - (zb < za);
+}
+
+/* Months of history required before scoring a month or flagging a category new or disappeared. */
+#define ANOMALY_MIN_HISTORY 3
+
+/*
+ * Walks each category's sparse month series once, filling gaps with zero
+ * spend, and scores every month against the running Welford mean and
+ * variance of the months before it. A category is flagged "new" only when the
+ * ledger has ANOMALY_MIN_HISTORY months before its first amount, and
+ * "disappeared" (in the month after its last amount) only once it has been
+ * absent for ANOMALY_MIN_HISTORY months, so ledger edges and irregular
+ * cadences do not read as churn.
+ */
+static void detect_category_anomalies(const CategoryList *list, const char *direction, int first_key, int last_key,
+                                      double z_threshold, AnomalyList *out) {
+  for (size_t c = 0; c < list->count; c++) {
+    const CategoryStat *stat = &list->items[c];
+    /* Space-Saving replacements only saw part of their history; skip them. */
+    if (stat->month_count == 0 || stat->error > 0) {
+      continue;
+    }
+    int start_key = stat->months[0].month_key;
+    int end_key = stat->months[stat->month_count - 1].month_key;
+    if (start_key - first_key >= ANOMALY_MIN_HISTORY) {
+      anomaly_list_add(out, stat->name, direction, start_key, "new", stat->months[0].amount, 0.0, 0.0, 0.0);
+    }
+    /* A disappeared category's trailing zeros are reported once, not scored month by month as drops. */
+    int score_end = last_key;
+    if (last_key - end_key >= ANOMALY_MIN_HISTORY) {
+      anomaly_list_add(out, stat->name, direction, end_key + 1, "disappeared", 0.0, 0.0, 0.0, 0.0);
+      score_end = end_key;
+    }
+    size_t next = 0;
+    int n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    for (int key = start_key; key <= score_end; key++) {
+      double spend = 0.0;
+      if (next < stat->month_count && stat->months[next].month_key == key) {
+        spend = stat->months[next++].amount;
+      }
+      if (n >= ANOMALY_MIN_HISTORY) {
+        double std_dev = sqrt(m2 / (n - 1));
+        if (std_dev > 0) {
+          double z = (spend - mean) / std_dev;
+          if (fabs(z) > z_threshold) {
+            anomaly_list_add(out, stat->name, direction, key, z > 0 ? "spike" : "drop", spend, mean, std_dev, z);
+          }
+        }
+      }
+      n++;
+      double delta = spend - mean;
+      mean += delta / n;
+      m2 += delta * (spend - mean);
+    }
+  }
+}
+
+static void detect_anomalies(const Ledger *ledger, double z_threshold, AnomalyList *out) {
+  const MonthList *months = &ledger->months;
+  if (months->count == 0) {
+    return;
+  }
+  int first_key = month_key_from(months->items[0].month);
+  int last_key = month_key_from(months->items[months->count - 1].month);
+  detect_category_anomalies(&ledger->categories, "outflow", first_key, last_key, z_threshold, out);
+  detect_category_anomalies(&ledger->inflow_categories, "inflow", first_key, last_key, z_threshold, out);
+  qsort(out->items, out->count, sizeof(Anomaly), compare_anomalies);
+}
+
+typedef struct {
+  const char *category;
+  double window_outflow;
+  double avg_burn;
+  int burn_months;
+  double runway_months;
+  double min_cut;
+} Sensitivity;
+
+typedef struct {
+  double net;
+  double outflow;
+  double breakpoint;
+} SensitivityPoint;
+
+static int compare_sensitivity_points(const void *a, const void *b) {
+  double da = ((const SensitivityPoint *)a)->breakpoint;
+  double db = ((const SensitivityPoint *)b)->breakpoint;
+  if (da < db) return -1;
+  if (da > db) return 1;
+  return 0;
+}
+
+/* Higher runway first; removing all burn ranks above any finite runway. */
+static int compare_sensitivity(const void *a, const void *b) {
+  const Sensitivity *sa = (const Sensitivity *)a;
+  const Sensitivity *sb = (const Sensitivity *)b;
+  int a_clear = sa->burn_months == 0;
+  int b_clear = sb->burn_months == 0;
+  if (a_clear != b_clear) return b_clear - a_clear;
+  if (sa->runway_months != sb->runway_months) return sa->runway_months < sb->runway_months ? 1 : -1;
+  return strcmp(sa->category, sb->category);
+}
+
+/*
+ * Runway impact of cutting each outflow category, evaluated against the
+ * summary's burn window. Average burn is the mean deficit over deficit
+ * months, so a cut only changes the window months where the category spent:
+ * each one either shrinks its deficit or flips to a surplus and leaves the
+ * average. Per category this is linear in its own sparse months, not in the
+ * window or the category count.
+ *
+ * min_cut is the smallest fraction reaching the target runway (-1 when a
+ * full cut falls short). Burn is piecewise linear in the cut between the
+ * sorted flip points, so each segment is solved in closed form.
+ */
+static Sensitivity *solve_sensitivity(const Ledger *ledger, const RunwaySummary *s, double cut, size_t *out_count) {
+  const MonthList *months = &ledger->months;
+  *out_count = 0;
+  Sensitivity *out = calloc(ledger->categories.count > 0 ? ledger->categories.count : 1, sizeof(Sensitivity));
+  if (!out) {
+    fprintf(stderr, "Memory allocation failed for sensitivity.\n");
+    exit(1);
+  }
+  if (s->month_start >= months->count) {
+    return out;
+  }
+  int first_key = month_key_from(months->items[s->month_start].month);
+  int last_key = month_key_from(months->items[months->count - 1].month);
+  size_t span = (size_t)(last_key - first_key + 1);
+  double *window_net = malloc(span * sizeof(double));
+  SensitivityPoint *points = malloc(span * sizeof(SensitivityPoint));
+  if (!window_net || !points) {
+    fprintf(stderr, "Memory allocation failed for sensitivity.\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < span; i++) {
+    window_net[i] = NAN;
+  }
+  double burn_total = 0.0;
+  for (size_t i = s->month_start; i < months->count; i++) {
+    double net = months->items[i].inflow - months->items[i].outflow;
+    window_net[month_key_from(months->items[i].month) - first_key] = net;
+    if (net < 0) burn_total -= net;
+  }
+  double target_burn = s->available_cash > 0 ? s->available_cash / s->target_runway_months : 0.0;
+  const double eps = 1e-9;
+
+  for (size_t c = 0; c < ledger->categories.count; c++) {
+    const CategoryStat *stat = &ledger->categories.items[c];
+    /* Space-Saving replacements only saw part of their history; skip them. */
+    if (stat->error > 0) {
+      continue;
+    }
+    Sensitivity *item = &out[(*out_count)++];
+    item->category = stat->name;
+    size_t point_count = 0;
+    double cut_burn = burn_total;
+    int cut_months = s->burn_count;
+    for (size_t m = 0; m < stat->month_count; m++) {
+      int key = stat->months[m].month_key;
+      double outflow = stat->months[m].amount;
+      if (key < first_key || key > last_key || isnan(window_net[key - first_key]) || outflow <= 0) {
+        continue;
+      }
+      double net = window_net[key - first_key];
+      item->window_outflow += outflow;
+      if (net >= 0) {
+        continue;
+      }
+      points[point_count].net = net;
+      points[point_count].outflow = outflow;
+      points[point_count].breakpoint = -net / outflow;
+      point_count++;
+      if (cut * outflow >= -net) {
+        cut_burn += net;
+        cut_months--;
+      } else {
+        cut_burn -= cut * outflow;
+      }
+    }
+    item->burn_months = cut_months;
+    item->avg_burn = cut_months > 0 ? cut_burn / cut_months : 0.0;
+    item->runway_months = item->avg_burn > 0 ? s->available_cash / item->avg_burn : 0.0;
+
+    qsort(points, point_count, sizeof(SensitivityPoint), compare_sensitivity_points);
+    double fixed_burn = burn_total;
+    double active_outflow = 0.0;
+    int active_months = s->burn_count;
+    for (size_t p = 0; p < point_count; p++) {
+      active_outflow += points[p].outflow;
+    }
+    item->min_cut = -1.0;
+    double lo = 0.0;
+    for (size_t p = 0; p <= point_count; p++) {
+      int last = p == point_count || points[p].breakpoint > 1.0;
+      double hi = last ? 1.0 : points[p].breakpoint;
+      double needed = lo;
+      if (active_months > 0) {
+        double excess = fixed_burn - target_burn * active_months;
+        needed = active_outflow > 0 ? excess / active_outflow : (excess <= eps ? lo : INFINITY);
+        if (needed < lo) needed = lo;
+      }
+      if (last ? needed <= hi + eps : needed < hi) {
+        item->min_cut = needed > 1.0 ? 1.0 : needed;
+        break;
+      }
+      if (last) {
+        break;
+      }
+      fixed_burn += points[p].net;
+      active_outflow -= points[p].outflow;
+      active_months--;
+      lo = hi;
+    }
+  }
+  free(window_net);
+  free(points);
+  qsort(out, *out_count, sizeof(Sensitivity), compare_sensitivity);
+  return out;
+}
+
+typedef struct {
+  char category[64];
+  int month_key;
+  int is_inflow;
+  double budget;
+  double actual;
+  int matched;
+} BudgetLine;
+
+/*
+ * Approved budget keyed by (direction, month, category). slots is an
+ * open-addressing index into items (item index + 1, 0 = empty) used as the
+ * build side of the join against the category x month cube.
+ */
+typedef struct {
+  BudgetLine *items;
+  size_t count;
+  size_t cap;
+  size_t *slots;
+  size_t slot_cap;
+  size_t rejected;
+  int has_inflow;
+  int first_key;
+  int last_key;
+} Budget;
+
+typedef struct {
+  const char *category;
+  int is_inflow;
+  double budget;
+  double actual;
+  size_t months;
+} BudgetCategory;
+
+typedef struct {
+  BudgetCategory *items;
+  size_t count;
+  size_t cap;
+} BudgetCategoryList;
+
+typedef struct {
+  double budget_outflow;
+  double actual_outflow;
+  double budget_inflow;
+  double actual_inflow;
+  size_t matched_lines;
+  double unbudgeted_outflow;
+  double unbudgeted_inflow;
+  size_t unbudgeted_cells;
+  BudgetCategoryList categories;
+  BudgetCategoryList unbudgeted;
+  size_t overlap_months;
+  double planned_avg_outflow;
+  double actual_avg_outflow;
+  size_t plan_months;
+  double plan_avg_inflow;
+  double plan_avg_outflow;
+  double plan_net;
+  double starting_balance;
+  double runway_months;
+  const char *risk;
+  int filtered;
+  size_t approximate;
+} BudgetReport;
+
+static uint64_t budget_hash(const char *category, int month_key, int is_inflow) {
+  return mix64(hash_name(category) ^ ((uint64_t)(unsigned)month_key << 1 | (uint64_t)is_inflow));
+}
+
+static size_t *budget_slot(Budget *budget, const char *category, int month_key, int is_inflow) {
+  size_t pos = (size_t)budget_hash(category, month_key, is_inflow) & (budget->slot_cap - 1);
+  while (budget->slots[pos] != 0) {
+    const BudgetLine *line = &budget->items[budget->slots[pos] - 1];
+    if (line->month_key == month_key && line->is_inflow == is_inflow && strcmp(line->category, category) == 0) {
+      break;
+    }
+    pos = (pos + 1) & (budget->slot_cap - 1);
+  }
+  return &budget->slots[pos];
+}
+
+static void budget_index_grow(Budget *budget) {
+  size_t next_cap = budget->slot_cap == 0 ? 256 : budget->slot_cap * 2;
+  size_t *next = calloc(next_cap, sizeof(size_t));
+  if (!next) {
+    fprintf(stderr, "Memory allocation failed for budget index.\n");
+    exit(1);
+  }
+  free(budget->slots);
+  budget->slots = next;
+  budget->slot_cap = next_cap;
+  for (size_t i = 0; i < budget->count; i++) {
+    const BudgetLine *line = &budget->items[i];
+    *budget_slot(budget, line->category, line->month_key, line->is_inflow) = i + 1;
+  }
+}
+
+/*
+ * Adds amount to the (category, month, direction) line; repeated lines
+ * accumulate. The name is truncated like category_list_add so long names
+ * still match the ledger's categories.
+ */
+static void budget_add(Budget *budget, const char *name, int month_key, int is_inflow, double amount) {
+  char category[64];
+  snprintf(category, sizeof(category), "%s", name);
+  if ((budget->count + 1) * 4 > budget->slot_cap * 3) {
+    budget_index_grow(budget);
+  }
+  size_t *slot = budget_slot(budget, category, month_key, is_inflow);
+  if (*slot != 0) {
+    budget->items[*slot - 1].budget += amount;
+    return;
+  }
+  if (budget->count == budget->cap) {
+    size_t next_cap = budget->cap == 0 ? 64 : budget->cap * 2;
+    BudgetLine *next = realloc(budget->items, next_cap * sizeof(BudgetLine));
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for budget lines.\n");
+      exit(1);
+    }
+    budget->items = next;
+    budget->cap = next_cap;
+  }
+  BudgetLine *line = &budget->items[budget->count];
+  memset(line, 0, sizeof(*line));
+  snprintf(line->category, sizeof(line->category), "%s", category);
+  line->month_key = month_key;
+  line->is_inflow = is_inflow;
+  line->budget = amount;
+  *slot = ++budget->count;
+  if (budget->count == 1 || month_key < budget->first_key) budget->first_key = month_key;
+  if (budget->count == 1 || month_key > budget->last_key) budget->last_key = month_key;
+  if (is_inflow) budget->has_inflow = 1;
+}
+
+/* Budget CSV: month (YYYY-MM or a YYYY-MM-DD date), category, amount, optional type (default outflow). */
+static int load_budget(const char *path, Budget *budget) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Failed to open budget file: %s\n", path);
+    return 1;
+  }
+  char line[MAX_LINE];
+  char fields[MAX_FIELDS][MAX_FIELD_LEN];
+  int header_parsed = 0;
+  int idx_month = -1, idx_category = -1, idx_amount = -1, idx_type = -1;
+  while (fgets(line, sizeof(line), fp)) {
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    if (!header_parsed) {
+      for (int i = 0; i < field_count; i++) {
+        char key[MAX_FIELD_LEN];
+        normalize_key(fields[i], key, sizeof(key));
+        if (strcmp(key, "month") == 0 || strcmp(key, "period") == 0 || strcmp(key, "date") == 0) {
+          idx_month = i;
+        } else if (strcmp(key, "category") == 0 || strcmp(key, "bucket") == 0 || strcmp(key, "lineitem") == 0) {
+          idx_category = i;
+        } else if (strcmp(key, "amount") == 0 || strcmp(key, "budget") == 0 || strcmp(key, "value") == 0) {
+          idx_amount = i;
+        } else if (strcmp(key, "type") == 0 || strcmp(key, "direction") == 0 || strcmp(key, "flow") == 0) {
+          idx_type = i;
+        }
+      }
+      header_parsed = 1;
+      if (idx_month == -1 || idx_category == -1 || idx_amount == -1) {
+        fprintf(stderr, "Missing budget headers. Need month, category, amount.\n");
+        fclose(fp);
+        return 1;
+      }
+      continue;
+    }
+    if (field_count <= idx_month || field_count <= idx_category || field_count <= idx_amount) {
+      budget->rejected++;
+      continue;
+    }
+    int ok = 0;
+    int date_key = iso_date_key(fields[idx_month]);
+    double amount = parse_amount(fields[idx_amount], &ok);
+    if (date_key < 0 || !ok || fields[idx_category][0] == '\0') {
+      budget->rejected++;
+      continue;
+    }
+    int is_inflow = idx_type >= 0 && idx_type < field_count && is_inflow_type(fields[idx_type]);
+    budget_add(budget, fields[idx_category], date_key / 10000 * 12 + date_key / 100 % 100 - 1, is_inflow,
+               fabs(amount));
+  }
+  fclose(fp);
+  if (budget->rejected > 0) {
+    fprintf(stderr, "Warning: ignored %zu malformed budget rows.\n", budget->rejected);
+  }
+  return 0;
+}
+
+static void budget_free(Budget *budget) {
+  free(budget->items);
+  free(budget->slots);
+  memset(budget, 0, sizeof(*budget));
+}
+
+static int compare_budget_lines(const void *a, const void *b) {
+  const BudgetLine *la = (const BudgetLine *)a;
+  const BudgetLine *lb = (const BudgetLine *)b;
+  if (la->is_inflow != lb->is_inflow) return la->is_inflow - lb->is_inflow;
+  int cmp = strcmp(la->category, lb->category);
+  if (cmp != 0) return cmp;
+  return la->month_key - lb->month_key;
+}
+
+/* Largest absolute variance first. */
+static int compare_budget_categories(const void *a, const void *b) {
+  const BudgetCategory *ca = (const BudgetCategory *)a;
+  const BudgetCategory *cb = (const BudgetCategory *)b;
+  double va = fabs(ca->actual - ca->budget);
+  double vb = fabs(cb->actual - cb->budget);
+  if (va != vb) return va < vb ? 1 : -1;
+  return strcmp(ca->category, cb->category);
+}
+
+static void budget_category_add(BudgetCategoryList *list, const BudgetCategory *item) {
+  if (list->count == list->cap) {
+    size_t next_cap = list->cap == 0 ? 16 : list->cap * 2;
+    BudgetCategory *next = realloc(list->items, next_cap * sizeof(BudgetCategory));
+    if (!next) {
+      fprintf(stderr, "Memory allocation failed for budget report.\n");
+      exit(1);
+    }
+    list->items = next;
+    list->cap = next_cap;
+  }
+  list->items[list->count++] = *item;
+}
+
+/*
+ * Hash join of the budget (build side) against the category x month cube
+ * (probe side): one pass over the budget to build, one pass over the cube
+ * cells inside the budget's month range to probe. Cells without a budget
+ * line are unbudgeted actuals; inflow cells are only probed when the budget
+ * plans inflow. Variance covers budget months up to the last actual month.
+ *
+ * Plan months for runway-under-budget are the budget months after the last
+ * actual month (all budget months when the budget does not reach past the
+ * actuals); inflow comes from budget inflow lines when present, otherwise
+ * from the summary's trailing average. The runway starts from the balance at
+ * the end of the actuals, like the --commitments projection.
+ *
+ * The result is partial when filtered is set (category or restricted filters
+ * dropped rows, so budgeted categories look under-spent) or when approximate
+ * categories from --max-categories hold only part of their month cells.
+ */
+static void budget_join(Budget *budget, const Ledger *ledger, const RunwaySummary *s, int filtered,
+                        BudgetReport *r) {
+  memset(r, 0, sizeof(*r));
+  r->risk = "not_at_risk";
+  r->filtered = filtered;
+  r->starting_balance = s->ending_cash > 0 ? s->ending_cash : 0.0;
+  if (budget->count == 0) {
+    return;
+  }
+  for (int d = 0; d <= budget->has_inflow; d++) {
+    const CategoryList *list = d == 0 ? &ledger->categories : &ledger->inflow_categories;
+    for (size_t c = 0; c < list->count; c++) {
+      const CategoryStat *stat = &list->items[c];
+      r->approximate += stat->error > 0;
+      BudgetCategory unbudgeted = {stat->name, d, 0.0, 0.0, 0};
+      for (size_t i = 0; i < stat->month_count; i++) {
+        const CategoryMonth *cell = &stat->months[i];
+        if (cell->month_key < budget->first_key || cell->month_key > budget->last_key) {
+          continue;
+        }
+        size_t slot = *budget_slot(budget, stat->name, cell->month_key, d);
+        if (slot != 0) {
+          budget->items[slot - 1].actual += cell->amount;
+          budget->items[slot - 1].matched = 1;
+        } else {
+          unbudgeted.actual += cell->amount;
+          unbudgeted.months++;
+        }
+      }
+      if (unbudgeted.months > 0) {
+        if (d == 0) {
+          r->unbudgeted_outflow += unbudgeted.actual;
+        } else {
+          r->unbudgeted_inflow += unbudgeted.actual;
+        }
+        r->unbudgeted_cells += unbudgeted.months;
+        budget_category_add(&r->unbudgeted, &unbudgeted);
+      }
+    }
+  }
+  qsort(r->unbudgeted.items, r->unbudgeted.count, sizeof(BudgetCategory), compare_budget_categories);
+
+  /* Slots are stale once lines are sorted; the join is done with them. */
+  free(budget->slots);
+  budget->slots = NULL;
+  budget->slot_cap = 0;
+  qsort(budget->items, budget->count, sizeof(BudgetLine), compare_budget_lines);
+  size_t span = (size_t)(budget->last_key - budget->first_key + 1);
+  double *plan_outflow = calloc(span, sizeof(double));
+  double *plan_inflow = calloc(span, sizeof(double));
+  if (!plan_outflow || !plan_inflow) {
+    fprintf(stderr, "Memory allocation failed for budget report.\n");
+    exit(1);
+  }
+  const MonthList *months = &ledger->months;
+  int last_actual = months->count > 0 ? month_key_from(months->items[months->count - 1].month) : budget->first_key - 1;
+  for (size_t i = 0; i < budget->count; i++) {
+    const BudgetLine *line = &budget->items[i];
+    double *plan = line->is_inflow ? plan_inflow : plan_outflow;
+    plan[line->month_key - budget->first_key] += line->budget;
+    r->matched_lines += (size_t)line->matched;
+    if (line->month_key > last_actual) {
+      continue;
+    }
+    if (line->is_inflow) {
+      r->budget_inflow += line->budget;
+      r->actual_inflow += line->actual;
+    } else {
+      r->budget_outflow += line->budget;
+      r->actual_outflow += line->actual;
+    }
+    if (r->categories.count > 0) {
+      BudgetCategory *last = &r->categories.items[r->categories.count - 1];
+      if (last->is_inflow == line->is_inflow && strcmp(last->category, line->category) == 0) {
+        last->budget += line->budget;
+        last->actual += line->actual;
+        last->months++;
+        continue;
+      }
+    }
+    BudgetCategory item = {line->category, line->is_inflow, line->budget, line->actual, 1};
+    budget_category_add(&r->categories, &item);
+  }
+  qsort(r->categories.items, r->categories.count, sizeof(BudgetCategory), compare_budget_categories);
+
+  double planned = 0.0;
+  double actual = 0.0;
+  for (size_t i = 0; i < months->count; i++) {
+    int key = month_key_from(months->items[i].month);
+    if (key >= budget->first_key && key <= budget->last_key && plan_outflow[key - budget->first_key] > 0) {
+      planned += plan_outflow[key - budget->first_key];
+      actual += months->items[i].outflow;
+      r->overlap_months++;
+    }
+  }
+  if (r->overlap_months > 0) {
+    r->planned_avg_outflow = planned / (double)r->overlap_months;
+    r->actual_avg_outflow = actual / (double)r->overlap_months;
+  }
+
+  int plan_start = budget->first_key;
+  if (last_actual >= budget->first_key && last_actual < budget->last_key) {
+    plan_start = last_actual + 1;
+  }
+  double plan_in = 0.0;
+  double plan_out = 0.0;
+  for (int key = plan_start; key <= budget->last_key; key++) {
+    plan_in += plan_inflow[key - budget->first_key];
+    plan_out += plan_outflow[key - budget->first_key];
+    r->plan_months++;
+  }
+  r->plan_avg_outflow = plan_out / (double)r->plan_months;
+  r->plan_avg_inflow = budget->has_inflow ? plan_in / (double)r->plan_months : s->avg_inflow;
+  r->plan_net = r->plan_avg_inflow - r->plan_avg_outflow;
+  if (r->plan_net < 0) {
+    r->runway_months = r->starting_balance / -r->plan_net;
+    r->risk = risk_from_runway(r->runway_months);
+  }
+  free(plan_outflow);
+  free(plan_inflow);
+}
+
+static void budget_report_free(BudgetReport *r) {
+  free(r->categories.items);
+  free(r->unbudgeted.items);
+}
+
+/*
+ * Known future cash events projected on a dense month array. Slot h is the
+ * h-th month after the last actual month; recurring commitments (end and
+ * every columns) are expanded into the slots they touch while loading.
+ */
+typedef struct {
+  int start_key;
+  int horizon;
+  double *inflow;
+  double *outflow;
+  size_t rows;
+  size_t rejected;
+  size_t open_ended;
+  size_t reversed;
+  size_t past;
+  size_t beyond;
+  double total_inflow;
+  double total_outflow;
+} Commitments;
+
+typedef struct {
+  int depletion_index;
+  double min_balance;
+  int min_index;
+  double ending_balance;
+} Projection;
+
+/*
+ * Commitments CSV: date (YYYY-MM or YYYY-MM-DD), amount, optional type
+ * (otherwise the sign decides, negative = outflow), optional end month and
+ * every (months between occurrences, default 1 when end is set). Rows with
+ * every but no end, or an end before the date, are rejected rather than read
+ * as a single occurrence or as nothing.
+ */
+static int load_commitments(const char *path, int start_key, int horizon, Commitments *c) {
+  memset(c, 0, sizeof(*c));
+  c->start_key = start_key;
+  c->horizon = horizon;
+  c->inflow = calloc((size_t)horizon, sizeof(double));
+  c->outflow = calloc((size_t)horizon, sizeof(double));
+  if (!c->inflow || !c->outflow) {
+    fprintf(stderr, "Memory allocation failed for commitments.\n");
+    exit(1);
+  }
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Failed to open commitments file: %s\n", path);
+    return 1;
+  }
+  char line[MAX_LINE];
+  char fields[MAX_FIELDS][MAX_FIELD_LEN];
+  int header_parsed = 0;
+  int idx_date = -1, idx_amount = -1, idx_type = -1, idx_end = -1, idx_every = -1;
+  while (fgets(line, sizeof(line), fp)) {
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    if (!header_parsed) {
+      for (int i = 0; i < field_count; i++) {
+        char key[MAX_FIELD_LEN];
+        normalize_key(fields[i], key, sizeof(key));
+        if (strcmp(key, "date") == 0 || strcmp(key, "month") == 0 || strcmp(key, "start") == 0) {
+          idx_date = i;
+        } else if (strcmp(key, "amount") == 0 || strcmp(key, "value") == 0) {
+          idx_amount = i;
+        } else if (strcmp(key, "type") == 0 || strcmp(key, "direction") == 0 || strcmp(key, "flow") == 0) {
+          idx_type = i;
+        } else if (strcmp(key, "end") == 0 || strcmp(key, "until") == 0 || strcmp(key, "endmonth") == 0) {
+          idx_end = i;
+        } else if (strcmp(key, "every") == 0 || strcmp(key, "intervalmonths") == 0) {
+          idx_every = i;
+        }
+      }
+      header_parsed = 1;
+      if (idx_date == -1 || idx_amount == -1) {
+        fprintf(stderr, "Missing commitment headers. Need date, amount.\n");
+        fclose(fp);
+        return 1;
+      }
+      continue;
+    }
+    if (field_count <= idx_date || field_count <= idx_amount) {
+      c->rejected++;
+      continue;
+    }
+    int ok = 0;
+    int date_key = iso_date_key(fields[idx_date]);
+    double amount = parse_amount(fields[idx_amount], &ok);
+    if (date_key < 0 || !ok) {
+      c->rejected++;
+      continue;
+    }
+    int first = date_key / 10000 * 12 + date_key / 100 % 100 - 1;
+    int last = first;
+    int every = 1;
+    int has_end = idx_end >= 0 && idx_end < field_count && fields[idx_end][0] != '\0';
+    if (has_end) {
+      int end_key = iso_date_key(fields[idx_end]);
+      if (end_key < 0) {
+        c->rejected++;
+        continue;
+      }
+      last = end_key / 10000 * 12 + end_key / 100 % 100 - 1;
+      if (last < first) {
+        c->reversed++;
+        continue;
+      }
+    }
+    if (idx_every >= 0 && idx_every < field_count && fields[idx_every][0] != '\0') {
+      every = atoi(fields[idx_every]);
+      if (every < 1) {
+        c->rejected++;
+        continue;
+      }
+      if (!has_end) {
+        c->open_ended++;
+        continue;
+      }
+    }
+    int is_inflow = amount >= 0;
+    if (idx_type >= 0 && idx_type < field_count) {
+      if (is_inflow_type(fields[idx_type])) {
+        is_inflow = 1;
+      } else if (is_outflow_type(fields[idx_type])) {
+        is_inflow = 0;
+      }
+    }
+    amount = fabs(amount);
+    double *slots = is_inflow ? c->inflow : c->outflow;
+    c->rows++;
+    for (int key = first; key <= last; key += every) {
+      int h = key - start_key;
+      if (h < 0) {
+        c->past++;
+      } else if (h >= horizon) {
+        c->beyond++;
+        break;
+      } else {
+        slots[h] += amount;
+        if (is_inflow) {
+          c->total_inflow += amount;
+        } else {
+          c->total_outflow += amount;
+        }
+      }
+    }
+  }
+  fclose(fp);
+  if (c->rejected > 0) {
+    fprintf(stderr, "Warning: ignored %zu malformed commitment rows.\n", c->rejected);
+  }
+  if (c->open_ended > 0) {
+    fprintf(stderr, "Warning: ignored %zu recurring commitment rows with every but no end.\n", c->open_ended);
+  }
+  if (c->reversed > 0) {
+    fprintf(stderr, "Warning: ignored %zu commitment rows whose end is before their date.\n", c->reversed);
+  }
+  return 0;
+}
+
+static void commitments_free(Commitments *c) {
+  free(c->inflow);
+  free(c->outflow);
+  memset(c, 0, sizeof(*c));
+}
+
+/*
+ * Walks the balance forward from start_balance: each month adds the
+ * scenario-adjusted trailing-window averages plus that month's commitments.
+ * path, when given, receives the month-end balances.
+ */
+static void project_commitments(const Commitments *c, const Scenario *scenario, const RunwaySummary *s,
+                                double start_balance, double *path, Projection *p) {
+  double base_net = s->avg_inflow * (1.0 + scenario->inflow_adj) - s->avg_outflow * (1.0 + scenario->outflow_adj);
+  double balance = start_balance;
+  p->depletion_index = -1;
+  p->min_balance = start_balance;
+  p->min_index = -1;
+  for (int h = 0; h < c->horizon; h++) {
+    balance += base_net + c->inflow[h] - c->outflow[h];
+    if (path) path[h] = balance;
+    if (balance < p->min_balance) {
+      p->min_balance = balance;
+      p->min_index = h;
+    }
+    if (p->depletion_index < 0 && balance <= 0.0) {
+      p->depletion_index = h;
+    }
+  }
+  p->ending_balance = balance;
+}
+
+typedef struct {
+  double min_counter;
+  double hhi;
+  double hhi_lower;
+  double hhi_upper;
+} HeavyHitterBounds;
+
+/*
+ * Concentration bounds for a Space-Saving list: a tracked item's true amount
+ * lies in [amount - error, amount], and every untracked item is at most the
+ * smallest counter, which caps their combined squared share.
+ */
+static void heavy_hitter_bounds(const CategoryList *list, double total, HeavyHitterBounds *b) {
+  memset(b, 0, sizeof(*b));
+  if (total <= 0 || list->count == 0) {
+    return;
+  }
+  double guaranteed = 0.0;
+  for (size_t i = 0; i < list->count; i++) {
+    double upper = list->items[i].outflow / total;
+    double lower = (list->items[i].outflow - list->items[i].error) / total;
+    b->hhi += upper * upper;
+    b->hhi_lower += lower * lower;
+    guaranteed += list->items[i].outflow - list->items[i].error;
+  }
+  b->min_counter = list->evicted > 0 ? list->items[list->count - 1].outflow : 0.0;
+  double untracked = total - guaranteed;
+  if (untracked < 0) untracked = 0.0;
+  b->hhi_upper = b->hhi + untracked * b->min_counter / (total * total);
+  if (b->hhi_upper > 1.0) b->hhi_upper = 1.0;
+}
+
+static void write_heavy_hitters(FILE *out, const char *label, const CategoryList *list, double total, int last) {
+  HeavyHitterBounds b;
+  heavy_hitter_bounds(list, total, &b);
+  fprintf(out, "    \"%s\": {\n", label);
+  fprintf(out, "      \"tracked\": %zu,\n", list->count);
+  fprintf(out, "      \"evicted\": %zu,\n", list->evicted);
+  fprintf(out, "      \"min_counter\": %.2f,\n", b.min_counter);
+  fprintf(out, "      \"hhi_estimate\": %.4f,\n", b.hhi);
+  fprintf(out, "      \"hhi_lower\": %.4f,\n", b.hhi_lower);
+  fprintf(out, "      \"hhi_upper\": %.4f,\n", b.hhi_upper);
+  fprintf(out, "      \"top\": [\n");
+  size_t top = list->count > 10 ? 10 : list->count;
+  for (size_t i = 0; i < top; i++) {
+    fprintf(out, "        {\"category\": ");
+    fprint_json_string(out, list->items[i].name);
+    fprintf(out, ", \"amount\": %.2f, \"error\": %.2f, \"guaranteed_amount\": %.2f}%s\n",
+            list->items[i].outflow, list->items[i].error, list->items[i].outflow - list->items[i].error,
+            i + 1 < top ? "," : "");
+  }
+  fprintf(out, "      ]\n");
+  fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+static void write_query_result(FILE *out, size_t index, const char *id, const RunwayParams *params,
+                               const RunwaySummary *s) {
+  fprintf(out, "{\"query\": %zu, \"id\": ", index);
+  fprint_json_string(out, id);
+  fprintf(out, ", \"as_of\": \"%s\", \"window_months\": %d, ", params->as_of, params->window_months);
+  fprintf(out, "\"starting_cash\": %.2f, \"reserved_cash\": %.2f, \"available_cash\": %.2f, ",
+          params->starting_cash, params->reserved_cash, s->available_cash);
+  fprintf(out, "\"months\": %zu, \"total_inflow\": %.2f, \"total_outflow\": %.2f, ",
+          s->month_count, s->total_inflow, s->total_outflow);
+  fprintf(out, "\"ending_balance\": %.2f, \"lowest_balance\": %.2f, \"lowest_balance_month\": \"%s\", ",
+          s->ending_cash, s->lowest_balance, s->month_count > 0 ? s->lowest_balance_month : "");
+  fprintf(out, "\"depletion_month\": \"%s\", ", s->depletion_index >= 0 ? s->depletion_month : "");
+  fprintf(out, "\"average_burn\": %.2f, \"burn_months\": %d, \"average_net\": %.2f, ",
+          s->avg_burn, s->burn_count, s->avg_net);
+  fprintf(out, "\"average_inflow\": %.2f, \"average_outflow\": %.2f, ", s->avg_inflow, s->avg_outflow);
+  fprintf(out, "\"estimated_runway_months\": %.2f, \"runway_risk\": \"%s\", ", s->runway_months, s->risk_level);
+  fprintf(out, "\"target_cash\": %.2f, \"funding_gap\": %.2f}", s->target_cash, s->funding_gap);
+}
+
+/*
+ * Answers a CSV of what-if parameter sets against the already-aggregated
+ * months. Columns (all optional, defaults come from the CLI flags): id, as_of,
+ * window, starting_cash, reserved_cash.
+ */
+static int run_queries(const char *queries_path, const char *out_path, int as_ndjson,
+                       const Ledger *ledger, const RunwayParams *defaults) {
+  FILE *fp = fopen(queries_path, "r");
+  if (!fp) {
+    fprintf(stderr, "Failed to open queries file: %s\n", queries_path);
+    return 1;
+  }
+  FILE *out = stdout;
+  if (out_path) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      fprintf(stderr, "Failed to write query results to %s\n", out_path);
+      fclose(fp);
+      return 1;
+    }
+  }
+
+  char line[MAX_LINE];
+  char fields[MAX_FIELDS][MAX_FIELD_LEN];
+  int header_parsed = 0;
+  int idx_id = -1, idx_as_of = -1, idx_window = -1, idx_starting = -1, idx_reserved = -1;
+  size_t answered = 0;
+  size_t invalid = 0;
+  clock_t started = clock();
+
+  if (!as_ndjson) {
+    fprintf(out, "[\n");
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
+    if (!header_parsed) {
+      for (int i = 0; i < field_count; i++) {
+        char key[MAX_FIELD_LEN];
+        normalize_key(fields[i], key, sizeof(key));
+        if (strcmp(key, "id") == 0 || strcmp(key, "name") == 0 || strcmp(key, "label") == 0) {
+          idx_id = i;
+        } else if (strcmp(key, "asof") == 0 || strcmp(key, "month") == 0) {
+          idx_as_of = i;
+        } else if (strcmp(key, "window") == 0 || strcmp(key, "windowmonths") == 0) {
+          idx_window = i;
+        } else if (strcmp(key, "startingcash") == 0 || strcmp(key, "starting") == 0) {
+          idx_starting = i;
+        } else if (strcmp(key, "reservedcash") == 0 || strcmp(key, "reserved") == 0) {
+          idx_reserved = i;
+        }
+      }
+      header_parsed = 1;
+      continue;
+    }
+    if (field_count == 1 && fields[0][0] == '\0') {
+      continue;
+    }
+
+    size_t index = answered + invalid + 1;
+    RunwayParams params = *defaults;
+    const char *id = idx_id >= 0 && idx_id < field_count ? fields[idx_id] : "";
+    const char *error = NULL;
+    if (idx_as_of >= 0 && idx_as_of < field_count && fields[idx_as_of][0] != '\0') {
+      if (!is_valid_month(fields[idx_as_of])) {
+        error = "invalid as_of (use YYYY-MM)";
+      } else if (defaults->as_of[0] && strcmp(fields[idx_as_of], defaults->as_of) > 0) {
+        /* The ledger was truncated at --as-of while loading, so later months are not in memory. */
+        error = "as_of is after the --as-of the ledger was loaded with";
+      } else {
+        copy_month(params.as_of, fields[idx_as_of]);
+      }
+    }
+    if (!error && idx_window >= 0 && idx_window < field_count && fields[idx_window][0] != '\0') {
+      params.window_months = atoi(fields[idx_window]);
+    }
+    if (!error && idx_starting >= 0 && idx_starting < field_count && fields[idx_starting][0] != '\0') {
+      int ok = 0;
+      params.starting_cash = parse_amount(fields[idx_starting], &ok);
+      if (!ok) error = "invalid starting_cash";
+    }
+    if (!error && idx_reserved >= 0 && idx_reserved < field_count && fields[idx_reserved][0] != '\0') {
+      int ok = 0;
+      params.reserved_cash = parse_amount(fields[idx_reserved], &ok);
+      if (!ok) error = "invalid reserved_cash";
+    }
+
+    if (!as_ndjson && index > 1) {
+      fprintf(out, ",\n");
+    }
+    if (!as_ndjson) {
+      fprintf(out, "  ");
+    }
+    if (error) {
+      invalid++;
+      fprintf(out, "{\"query\": %zu, \"id\": ", index);
+      fprint_json_string(out, id);
+      fprintf(out, ", \"error\": \"%s\"}", error);
+    } else {
+      RunwaySummary summary;
+      size_t count = month_upper_bound(ledger->months.items, ledger->months.count, params.as_of);
+      compute_summary(ledger->months.items, count, &params, &summary, NULL, NULL);
+      write_query_result(out, index, id, &params, &summary);
+      answered++;
+    }
+    if (as_ndjson) {
+      fprintf(out, "\n");
+    }
+  }
+  if (!as_ndjson) {
+    fprintf(out, "%s]\n", answered + invalid > 0 ? "\n" : "");
+  }
+  double elapsed_ms = (double)(clock() - started) * 1000.0 / CLOCKS_PER_SEC;
+
+  fclose(fp);
+  if (out != stdout) {
+    fclose(out);
+  }
+  fprintf(stderr, "Answered %zu queries (%zu invalid) against %zu months in %.2f ms\n",
+          answered, invalid, ledger->months.count, elapsed_ms);
+  return 0;
+}
+
+/*
+ * Local run history. PATH holds one HistoryRecord plus its HistoryMonth rows
+ * per run; PATH.idx holds one fixed-size HistoryIndexEntry per run pointing
+ * into it. Both start with an 8-byte magic, are append-only, and use native
+ * byte order. Trend queries read only the index.
+ */
+#define HISTORY_DATA_MAGIC "GSRDAT01"
+#define HISTORY_INDEX_MAGIC "GSRIDX01"
+
+typedef struct {
+  int64_t run_time;
+  int32_t as_of_key;
+  int32_t month_count;
+  int32_t window_months;
+  int32_t record_count;
+  double starting_cash;
+  double reserved_cash;
+  double total_inflow;
+  double total_outflow;
+  double available_cash;
+  double ending_cash;
+  double lowest_balance;
+  double avg_inflow;
+  double avg_outflow;
+  double avg_burn;
+  double avg_net;
+  double net_volatility;
+  double runway_months;
+  double funding_gap;
+  double net_trend_delta;
+  char risk[16];
+} HistoryRecord;
+
+typedef struct {
+  int32_t month_key;
+  int32_t reserved;
+  double inflow;
+  double outflow;
+  double balance;
+} HistoryMonth;
+
+typedef struct {
+  int64_t run_time;
+  int32_t as_of_key;
+  int32_t month_count;
+  uint64_t data_offset;
+  uint64_t data_length;
+  double runway_months;
+  double avg_burn;
+  double avg_net;
+  double available_cash;
+  double ending_cash;
+  double funding_gap;
+  char risk[16];
+} HistoryIndexEntry;
+
+/*
+ * Opens path for appending records of record_size bytes, writing magic to a
+ * new file and checking it on an existing one. The file is positioned after
+ * the last complete record, so a torn tail is overwritten by the next append.
+ */
+static FILE *history_open_append(const char *path, const char *magic, size_t record_size) {
+  FILE *fp = fopen(path, "rb+");
+  if (!fp) {
+    fp = fopen(path, "wb+");
+  }
+  if (!fp) {
+    fprintf(stderr, "Failed to open history file: %s\n", path);
+    return NULL;
+  }
+  char found[8];
+  if (fread(found, 1, sizeof(found), fp) == sizeof(found)) {
+    if (memcmp(found, magic, sizeof(found)) != 0) {
+      fprintf(stderr, "Not a runway history file: %s\n", path);
+      fclose(fp);
+      return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 8 + (size - 8) / (long)record_size * (long)record_size, SEEK_SET);
+  } else {
+    fseek(fp, 0, SEEK_SET);
+    if (fwrite(magic, 1, 8, fp) != 8) {
+      fprintf(stderr, "Failed to write history file: %s\n", path);
+      fclose(fp);
+      return NULL;
+    }
+  }
+  return fp;
+}
+
+/*
+ * Appends one run. The data record is written and closed before its index
+ * entry, so an interrupted run leaves at most unreferenced data bytes.
+ */
+static int history_append(const char *path, const HistoryRecord *record, const HistoryMonth *months) {
+  char index_path[4096];
+  if (snprintf(index_path, sizeof(index_path), "%s.idx", path) >= (int)sizeof(index_path)) {
+    fprintf(stderr, "History path too long: %s\n", path);
+    return 1;
+  }
+  FILE *data = history_open_append(path, HISTORY_DATA_MAGIC, 1);
+  if (!data) {
+    return 1;
+  }
+  long offset = ftell(data);
+  size_t month_count = (size_t)record->month_count;
+  int failed = offset < 0 || fwrite(record, sizeof(*record), 1, data) != 1 ||
+               (month_count > 0 && fwrite(months, sizeof(*months), month_count, data) != month_count);
+  failed |= fclose(data) != 0;
+  if (failed) {
+    fprintf(stderr, "Failed to write history file: %s\n", path);
+    return 1;
+  }
+
+  HistoryIndexEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.run_time = record->run_time;
+  entry.as_of_key = record->as_of_key;
+  entry.month_count = record->month_count;
+  entry.data_offset = (uint64_t)offset;
+  entry.data_length = sizeof(*record) + month_count * sizeof(*months);
+  entry.runway_months = record->runway_months;
+  entry.avg_burn = record->avg_burn;
+  entry.avg_net = record->avg_net;
+  entry.available_cash = record->available_cash;
+  entry.ending_cash = record->ending_cash;
+  entry.funding_gap = record->funding_gap;
+  memcpy(entry.risk, record->risk, sizeof(entry.risk));
+  FILE *index = history_open_append(index_path, HISTORY_INDEX_MAGIC, sizeof(HistoryIndexEntry));
+  if (!index) {
+    return 1;
+  }
+  failed = fwrite(&entry, sizeof(entry), 1, index) != 1;
+  failed |= fclose(index) != 0;
+  if (failed) {
+    fprintf(stderr, "Failed to write history index: %s\n", index_path);
+    return 1;
+  }
+  return 0;
+}
+
+/* Reads every complete index entry in one pass; a torn trailing entry is ignored. */
+static int history_load_index(const char *path, HistoryIndexEntry **entries, size_t *count) {
+  char index_path[4096];
+  snprintf(index_path, sizeof(index_path), "%s.idx", path);
+  FILE *fp = fopen(index_path, "rb");
+  if (!fp) {
+    fprintf(stderr, "Failed to open history index: %s\n", index_path);
+    return 1;
+  }
+  char magic[8];
+  if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, HISTORY_INDEX_MAGIC, 8) != 0) {
+    fprintf(stderr, "Not a runway history index: %s\n", index_path);
+    fclose(fp);
+    return 1;
+  }
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  size_t n = size > 8 ? (size_t)(size - 8) / sizeof(HistoryIndexEntry) : 0;
+  *entries = NULL;
+  *count = 0;
+  if (n > 0) {
+    *entries = malloc(n * sizeof(HistoryIndexEntry));
+    if (!*entries) {
+      fprintf(stderr, "Memory allocation failed for history index.\n");
+      exit(1);
+    }
+    fseek(fp, 8, SEEK_SET);
+    *count = fread(*entries, sizeof(HistoryIndexEntry), n, fp);
+  }
+  fclose(fp);
+  return 0;
+}
+
+/* Loads the data record an index entry points at; months must hold entry->month_count rows. */
+static int history_read_record(const char *path, const HistoryIndexEntry *entry, HistoryRecord *record,
+                               HistoryMonth *months) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "Failed to open history file: %s\n", path);
+    return 1;
+  }
+  size_t month_count = (size_t)entry->month_count;
+  int ok = fseek(fp, (long)entry->data_offset, SEEK_SET) == 0 && fread(record, sizeof(*record), 1, fp) == 1 &&
+           record->run_time == entry->run_time && record->month_count == entry->month_count &&
+           (month_count == 0 || fread(months, sizeof(*months), month_count, fp) == month_count);
+  fclose(fp);
+  if (!ok) {
+    fprintf(stderr, "History file does not match its index: %s\n", path);
+    return 1;
+  }
+  return 0;
+}
+
+static int compare_history_entries(const void *a, const void *b) {
+  const HistoryIndexEntry *ea = (const HistoryIndexEntry *)a;
+  const HistoryIndexEntry *eb = (const HistoryIndexEntry *)b;
+  if (ea->as_of_key != eb->as_of_key) return ea->as_of_key < eb->as_of_key ? -1 : 1;
+  if (ea->run_time != eb->run_time) return ea->run_time < eb->run_time ? -1 : 1;
+  if (ea->data_offset != eb->data_offset) return ea->data_offset < eb->data_offset ? -1 : 1;
+  return 0;
+}
+
+static void format_run_time(int64_t run_time, char *dst, size_t dst_len) {
+  time_t t = (time_t)run_time;
+  struct tm *tm = gmtime(&t);
+  if (!tm || strftime(dst, dst_len, "%Y-%m-%dT%H:%M:%SZ", tm) == 0) {
+    snprintf(dst, dst_len, "%lld", (long long)run_time);
+  }
+}
+
+/*
+ * --history mode: one trend point per as-of month (the latest run for that
+ * month), taken straight from the index, plus the month balances of the
+ * latest point read from the data file.
+ */
+static int run_history(const char *path, const char *json_path) {
+  HistoryIndexEntry *entries = NULL;
+  size_t count = 0;
+  if (history_load_index(path, &entries, &count) != 0) {
+    return 1;
+  }
+  qsort(entries, count, sizeof(HistoryIndexEntry), compare_history_entries);
+  size_t points = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (i + 1 < count && entries[i + 1].as_of_key == entries[i].as_of_key) {
+      continue;
+    }
+    entries[points++] = entries[i];
+  }
+
+  /* "latest" is the most recent run (ties go to the later append), whatever its as-of month. */
+  HistoryRecord latest;
+  HistoryMonth *latest_months = NULL;
+  if (points > 0) {
+    const HistoryIndexEntry *last = &entries[0];
+    for (size_t i = 1; i < points; i++) {
+      if (entries[i].run_time > last->run_time ||
+          (entries[i].run_time == last->run_time && entries[i].data_offset > last->data_offset)) {
+        last = &entries[i];
+      }
+    }
+    latest_months = calloc(last->month_count > 0 ? (size_t)last->month_count : 1, sizeof(HistoryMonth));
+    if (!latest_months) {
+      fprintf(stderr, "Memory allocation failed for history months.\n");
+      exit(1);
+    }
+    if (history_read_record(path, last, &latest, latest_months) != 0) {
+      free(latest_months);
+      free(entries);
+      return 1;
+    }
+  }
+
+  char month[8];
+  char stamp[32];
+  printf("Group Scholar Funding Runway History\n");
+  printf("Snapshots: %zu | As-of months: %zu\n", count, points);
+  if (points > 0) {
+    printf("As-of    Run                   Runway   Avg burn      Avg net       Ending cash   Risk\n");
+    for (size_t i = 0; i < points; i++) {
+      const HistoryIndexEntry *e = &entries[i];
+      month_from_key(e->as_of_key, month);
+      format_run_time(e->run_time, stamp, sizeof(stamp));
+      printf("%s  %s  %6.1f   $%-11.2f  $%-11.2f  $%-11.2f  %s\n", month, stamp, e->runway_months, e->avg_burn,
+             e->avg_net, e->ending_cash, e->risk);
+    }
+    const HistoryIndexEntry *first = &entries[0];
+    const HistoryIndexEntry *last = &entries[points - 1];
+    printf("Trend since first as-of: Runway %+.1f months | Avg burn %+.2f | Ending cash %+.2f\n",
+           last->runway_months - first->runway_months, last->avg_burn - first->avg_burn,
+           last->ending_cash - first->ending_cash);
+  }
+
+  int status = 0;
+  if (json_path) {
+    FILE *out = fopen(json_path, "w");
+    if (!out) {
+      fprintf(stderr, "Failed to write JSON to %s\n", json_path);
+      status = 1;
+    } else {
+      fprintf(out, "{\n");
+      fprintf(out, "  \"snapshots\": %zu,\n", count);
+      fprintf(out, "  \"trend\": [\n");
+      for (size_t i = 0; i < points; i++) {
+        const HistoryIndexEntry *e = &entries[i];
+        month_from_key(e->as_of_key, month);
+        format_run_time(e->run_time, stamp, sizeof(stamp));
+        fprintf(out,
+                "    {\"as_of\": \"%s\", \"run_time\": \"%s\", \"runway_months\": %.2f, \"avg_burn\": %.2f, "
+                "\"avg_net\": %.2f, \"available_cash\": %.2f, \"ending_cash\": %.2f, \"funding_gap\": %.2f, "
+                "\"risk\": \"%s\"}%s\n",
+                month, stamp, e->runway_months, e->avg_burn, e->avg_net, e->available_cash, e->ending_cash,
+                e->funding_gap, e->risk, i + 1 < points ? "," : "");
+      }
+      fprintf(out, "  ],\n");
+      if (points > 0) {
+        const HistoryIndexEntry *first = &entries[0];
+        const HistoryIndexEntry *last = &entries[points - 1];
+        fprintf(out, "  \"runway_change\": %.2f,\n", last->runway_months - first->runway_months);
+        fprintf(out, "  \"avg_burn_change\": %.2f,\n", last->avg_burn - first->avg_burn);
+        month_from_key(latest.as_of_key, month);
+        format_run_time(latest.run_time, stamp, sizeof(stamp));
+        fprintf(out, "  \"latest\": {\"as_of\": \"%s\", \"run_time\": \"%s\", \"window_months\": %d, ", month, stamp,
+                latest.window_months);
+        fprintf(out, "\"starting_cash\": %.2f, \"reserved_cash\": %.2f, \"records\": %d, \"months\": [\n",
+                latest.starting_cash, latest.reserved_cash, latest.record_count);
+        for (int32_t i = 0; i < latest.month_count; i++) {
+          month_from_key(latest_months[i].month_key, month);
+          fprintf(out, "    {\"month\": \"%s\", \"inflow\": %.2f, \"outflow\": %.2f, \"balance\": %.2f}%s\n", month,
+                  latest_months[i].inflow, latest_months[i].outflow, latest_months[i].balance,
+                  i + 1 < latest.month_count ? "," : "");
+        }
+        fprintf(out, "  ]}\n");
+      } else {
+        fprintf(out, "  \"runway_change\": 0.00,\n");
+        fprintf(out, "  \"avg_burn_change\": 0.00,\n");
+        fprintf(out, "  \"latest\": null\n");
+      }
+      fprintf(out, "}\n");
+      fclose(out);
+      printf("\nJSON report written to %s\n", json_path);
+    }
+  }
+  free(latest_months);
+  free(entries);
+  return status;
 }
 
 int main(int argc, char **argv) {
   const char *file_path = NULL;
   const char *json_path = NULL;
+  const char *arrow_dir = NULL;
+  double anomaly_z = 3.0;
+  double sensitivity_cut = 0.10;
+  const char *queries_path = NULL;
+  const char *query_out_path = NULL;
+  const char *history_path = NULL;
+  const char *budget_path = NULL;
+  const char *commitments_path = NULL;
+  int horizon_months = 36;
+  const char *history_query_path = NULL;
+  int query_ndjson = 1;
   double starting_cash = 0.0;
   double reserved_cash = 0.0;
   int window_months = 0;
   char as_of[8] = "";
   int starting_cash_set = 0;
+  LedgerOptions load_opts = {0};
+  const char *fx_path = NULL;
+  FxTable fx = {0};
+  strcpy(fx.report_currency, "USD");
 
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
@@ -332,17 +3792,104 @@ int main(int argc, char **argv) {
       window_months = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--as-of") == 0 && i + 1 < argc) {
       const char *value = argv[++i];
-      if (strlen(value) != 7 || value[4] != '-' || !isdigit((unsigned char)value[0]) ||
-          !isdigit((unsigned char)value[1]) || !isdigit((unsigned char)value[2]) ||
-          !isdigit((unsigned char)value[3]) || !isdigit((unsigned char)value[5]) ||
-          !isdigit((unsigned char)value[6])) {
+      if (!is_valid_month(value)) {
         fprintf(stderr, "Invalid --as-of value. Use YYYY-MM.\n");
         return 1;
       }
-      strncpy(as_of, value, sizeof(as_of) - 1);
-      as_of[7] = '\0';
+      copy_month(as_of, value);
+    } else if ((strcmp(argv[i], "--from") == 0 || strcmp(argv[i], "--to") == 0) && i + 1 < argc) {
+      int is_from = strcmp(argv[i], "--from") == 0;
+      const char *value = argv[++i];
+      if (!is_valid_date_bound(value)) {
+        fprintf(stderr, "Invalid %s value. Use YYYY-MM or YYYY-MM-DD.\n", is_from ? "--from" : "--to");
+        return 1;
+      }
+      strcpy(is_from ? load_opts.from : load_opts.to, value);
+    } else if (strcmp(argv[i], "--category") == 0 && i + 1 < argc) {
+      if (load_opts.category_count == MAX_CATEGORY_FILTERS) {
+        fprintf(stderr, "Too many --category filters (max %d).\n", MAX_CATEGORY_FILTERS);
+        return 1;
+      }
+      load_opts.categories[load_opts.category_count++] = argv[++i];
+    } else if (strcmp(argv[i], "--exclude-category") == 0 && i + 1 < argc) {
+      if (load_opts.exclude_count == MAX_CATEGORY_FILTERS) {
+        fprintf(stderr, "Too many --exclude-category filters (max %d).\n", MAX_CATEGORY_FILTERS);
+        return 1;
+      }
+      load_opts.exclude_categories[load_opts.exclude_count++] = argv[++i];
+    } else if (strcmp(argv[i], "--restricted-only") == 0) {
+      load_opts.restricted_only = 1;
+    } else if (strcmp(argv[i], "--date-format") == 0 && i + 1 < argc) {
+      const char *value = argv[++i];
+      load_opts.date_format = date_format_lookup(value);
+      if (!load_opts.date_format) {
+        fprintf(stderr, "Invalid --date-format value. Use a layout such as YYYY-MM-DD, MM/DD/YYYY or DD.MM.YYYY.\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--sorted") == 0) {
+      load_opts.assume_sorted = 1;
+    } else if (strcmp(argv[i], "--dedupe") == 0) {
+      load_opts.dedupe = 1;
+    } else if (strcmp(argv[i], "--max-categories") == 0 && i + 1 < argc) {
+      int value = atoi(argv[++i]);
+      if (value < 1) {
+        fprintf(stderr, "Invalid --max-categories value. Use a positive count.\n");
+        return 1;
+      }
+      load_opts.max_categories = (size_t)value;
+    } else if (strcmp(argv[i], "--fx-rates") == 0 && i + 1 < argc) {
+      fx_path = argv[++i];
+    } else if (strcmp(argv[i], "--report-currency") == 0 && i + 1 < argc) {
+      normalize_currency(argv[++i], fx.report_currency);
+      if (fx.report_currency[0] == '\0') {
+        fprintf(stderr, "Invalid --report-currency value.\n");
+        return 1;
+      }
     } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
       json_path = argv[++i];
+    } else if (strcmp(argv[i], "--anomaly-z") == 0 && i + 1 < argc) {
+      anomaly_z = atof(argv[++i]);
+      if (anomaly_z <= 0) {
+        fprintf(stderr, "Invalid --anomaly-z value. Use a positive number.\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--commitments") == 0 && i + 1 < argc) {
+      commitments_path = argv[++i];
+    } else if (strcmp(argv[i], "--horizon") == 0 && i + 1 < argc) {
+      horizon_months = atoi(argv[++i]);
+      if (horizon_months < 1 || horizon_months > 1200) {
+        fprintf(stderr, "Invalid --horizon value. Use 1 to 1200 months.\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+      budget_path = argv[++i];
+    } else if (strcmp(argv[i], "--sensitivity-cut") == 0 && i + 1 < argc) {
+      double value = atof(argv[++i]);
+      if (value <= 0 || value > 100) {
+        fprintf(stderr, "Invalid --sensitivity-cut value. Use a percentage between 0 and 100.\n");
+        return 1;
+      }
+      sensitivity_cut = value / 100.0;
+    } else if (strcmp(argv[i], "--arrow") == 0 && i + 1 < argc) {
+      arrow_dir = argv[++i];
+    } else if (strcmp(argv[i], "--history-file") == 0 && i + 1 < argc) {
+      history_path = argv[++i];
+    } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+      history_query_path = argv[++i];
+    } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+      queries_path = argv[++i];
+    } else if (strcmp(argv[i], "--query-out") == 0 && i + 1 < argc) {
+      query_out_path = argv[++i];
+    } else if (strcmp(argv[i], "--query-format") == 0 && i + 1 < argc) {
+      const char *value = argv[++i];
+      if (strcmp(value, "ndjson") == 0) {
+        query_ndjson = 1;
+      } else if (strcmp(value, "json") == 0) {
+        query_ndjson = 0;
+      } else {
+        fprintf(stderr, "Invalid --query-format value. Use ndjson or json.\n");
+        return 1;
+      }
     } else if (strcmp(argv[i], "--help") == 0) {
       print_usage();
       return 0;
@@ -353,130 +3900,56 @@ int main(int argc, char **argv) {
     }
   }
 
-  if (!file_path || !starting_cash_set) {
-    print_usage();
-    return 1;
+  if (history_query_path) {
+    return run_history(history_query_path, json_path);
   }
 
-  FILE *fp = fopen(file_path, "r");
-  if (!fp) {
-    fprintf(stderr, "Failed to open file: %s\n", file_path);
+  if (queries_path && history_path) {
+    fprintf(stderr, "--history-file cannot be combined with --queries; query answers are not recorded runs.\n");
+    return 1;
+  }
+  if (!file_path || (!starting_cash_set && !queries_path)) {
+    print_usage();
     return 1;
   }
 
-  char line[MAX_LINE];
-  char fields[MAX_FIELDS][MAX_FIELD_LEN];
-  int header_parsed = 0;
-  int idx_date = -1, idx_amount = -1, idx_type = -1, idx_category = -1, idx_restricted = -1;
-
-  MonthList months = {0};
-  CategoryList categories = {0};
-  CategoryList inflow_categories = {0};
-
-  size_t record_count = 0;
-  size_t skipped = 0;
-  double total_inflow = 0.0;
-  double total_outflow = 0.0;
-  double total_restricted = 0.0;
-
-  while (fgets(line, sizeof(line), fp)) {
-    int field_count = parse_csv_line(line, fields, MAX_FIELDS);
-    if (!header_parsed) {
-      for (int i = 0; i < field_count; i++) {
-        char key[MAX_FIELD_LEN];
-        normalize_key(fields[i], key, sizeof(key));
-        if (strcmp(key, "date") == 0 || strcmp(key, "transactiondate") == 0 || strcmp(key, "txn") == 0 || strcmp(key, "txndate") == 0) {
-          idx_date = i;
-        } else if (strcmp(key, "amount") == 0 || strcmp(key, "value") == 0 || strcmp(key, "net") == 0) {
-          idx_amount = i;
-        } else if (strcmp(key, "type") == 0 || strcmp(key, "direction") == 0 || strcmp(key, "flow") == 0) {
-          idx_type = i;
-        } else if (strcmp(key, "category") == 0 || strcmp(key, "memo") == 0 || strcmp(key, "bucket") == 0) {
-          idx_category = i;
-        } else if (strcmp(key, "restricted") == 0 || strcmp(key, "restrictedflag") == 0 || strcmp(key, "restrictedfunds") == 0) {
-          idx_restricted = i;
-        }
-      }
-      header_parsed = 1;
-      if (idx_date == -1 || idx_amount == -1 || idx_type == -1 || idx_category == -1) {
-        fprintf(stderr, "Missing required headers. Need date, amount, type, category.\n");
-        fclose(fp);
-        return 1;
-      }
-      continue;
-    }
-
-    if (field_count <= idx_amount || field_count <= idx_date) {
-      skipped++;
-      continue;
-    }
-
-    int ok = 0;
-    double amount = parse_amount(fields[idx_amount], &ok);
-    if (!ok) {
-      skipped++;
-      continue;
-    }
-
-    const char *date = fields[idx_date];
-    if (strlen(date) < 7) {
-      skipped++;
-      continue;
-    }
-
-    char month[8];
-    strncpy(month, date, 7);
-    month[7] = '\0';
-
-    if (as_of[0] != '\0' && strcmp(month, as_of) > 0) {
-      skipped++;
-      continue;
-    }
-
-    const char *type = fields[idx_type];
-    int is_inflow = 0;
-    if (is_inflow_type(type)) {
-      is_inflow = 1;
-    } else if (is_outflow_type(type)) {
-      is_inflow = 0;
-    } else if (amount < 0) {
-      is_inflow = 0;
-      amount = -amount;
-    } else {
-      is_inflow = 1;
-    }
-
-    const char *category = idx_category >= 0 && idx_category < field_count ? fields[idx_category] : "Uncategorized";
-    int restricted = 0;
-    if (idx_restricted >= 0 && idx_restricted < field_count) {
-      restricted = is_truthy(fields[idx_restricted]);
+  Ledger ledger = {0};
+  copy_month(load_opts.as_of, as_of);
+  if (fx_path) {
+    if (load_fx_rates(fx_path, &fx) != 0) {
+      fx_table_free(&fx);
+      return 1;
     }
+    load_opts.fx = &fx;
+  }
+  load_opts.report_currency = fx.report_currency;
+  if (load_ledger(file_path, &load_opts, &ledger) != 0) {
+    ledger_free(&ledger);
+    fx_table_free(&fx);
+    return 1;
+  }
 
-    record_count++;
+  RunwayParams params = {starting_cash, reserved_cash, window_months, ""};
+  copy_month(params.as_of, as_of);
 
-    if (is_inflow) {
-      total_inflow += amount;
-      month_list_add(&months, month, amount, 0.0);
-      category_list_add(&inflow_categories, category[0] ? category : "Uncategorized", amount);
-    } else {
-      total_outflow += amount;
-      month_list_add(&months, month, 0.0, amount);
-      category_list_add(&categories, category[0] ? category : "Uncategorized", amount);
-      if (restricted) {
-        total_restricted += amount;
-      }
-    }
+  if (queries_path) {
+    int status = run_queries(queries_path, query_out_path, query_ndjson, &ledger, &params);
+    ledger_free(&ledger);
+    fx_table_free(&fx);
+    return status;
   }
 
-  fclose(fp);
-
-  qsort(months.items, months.count, sizeof(MonthStat), compare_months);
-  qsort(categories.items, categories.count, sizeof(CategoryStat), compare_categories);
-  qsort(inflow_categories.items, inflow_categories.count, sizeof(CategoryStat), compare_categories);
+  MonthList months = ledger.months;
+  CategoryList categories = ledger.categories;
+  CategoryList inflow_categories = ledger.inflow_categories;
+  size_t record_count = ledger.record_count;
+  size_t skipped = ledger.skipped;
+  size_t filtered = ledger.filtered;
+  double total_inflow = ledger.total_inflow;
+  double total_outflow = ledger.total_outflow;
+  double total_restricted = ledger.total_restricted;
 
   double net = total_inflow - total_outflow;
-  double available_cash = starting_cash - reserved_cash;
-  if (available_cash < 0) available_cash = 0.0;
 
   double inflow_hhi = 0.0;
   double outflow_hhi = 0.0;
@@ -503,24 +3976,6 @@ int main(int argc, char **argv) {
 
   double *month_net = NULL;
   double *month_balance = NULL;
-  double ending_cash = available_cash;
-  double lowest_balance = available_cash;
-  char lowest_balance_month[8] = "";
-  int depletion_index = -1;
-  double depletion_balance = 0.0;
-  char depletion_month[8] = "";
-  double peak_inflow = 0.0;
-  double peak_outflow = 0.0;
-  char peak_inflow_month[8] = "";
-  char peak_outflow_month[8] = "";
-  int deficit_months = 0;
-  double best_net = 0.0;
-  double worst_net = 0.0;
-  char best_net_month[8] = "";
-  char worst_net_month[8] = "";
-  int longest_deficit_streak = 0;
-  char longest_deficit_start[8] = "";
-  char longest_deficit_end[8] = "";
   if (months.count > 0) {
     month_net = calloc(months.count, sizeof(double));
     month_balance = calloc(months.count, sizeof(double));
@@ -528,143 +3983,15 @@ int main(int argc, char **argv) {
       fprintf(stderr, "Memory allocation failed for balances.\n");
       free(month_net);
       free(month_balance);
-      free(months.items);
-      free(categories.items);
+      ledger_free(&ledger);
       return 1;
     }
-    double balance = available_cash;
-    int current_deficit_streak = 0;
-    char current_deficit_start[8] = "";
-    for (size_t i = 0; i < months.count; i++) {
-      month_net[i] = months.items[i].inflow - months.items[i].outflow;
-      balance += month_net[i];
-      month_balance[i] = balance;
-      if (i == 0 || month_net[i] > best_net) {
-        best_net = month_net[i];
-        strncpy(best_net_month, months.items[i].month, sizeof(best_net_month) - 1);
-        best_net_month[7] = '\0';
-      }
-      if (i == 0 || month_net[i] < worst_net) {
-        worst_net = month_net[i];
-        strncpy(worst_net_month, months.items[i].month, sizeof(worst_net_month) - 1);
-        worst_net_month[7] = '\0';
-      }
-      if (month_net[i] < 0) {
-        deficit_months++;
-        if (current_deficit_streak == 0) {
-          strncpy(current_deficit_start, months.items[i].month, sizeof(current_deficit_start) - 1);
-          current_deficit_start[7] = '\0';
-        }
-        current_deficit_streak++;
-        if (current_deficit_streak > longest_deficit_streak) {
-          longest_deficit_streak = current_deficit_streak;
-          strncpy(longest_deficit_start, current_deficit_start, sizeof(longest_deficit_start) - 1);
-          longest_deficit_start[7] = '\0';
-          strncpy(longest_deficit_end, months.items[i].month, sizeof(longest_deficit_end) - 1);
-          longest_deficit_end[7] = '\0';
-        }
-      } else {
-        current_deficit_streak = 0;
-        current_deficit_start[0] = '\0';
-      }
-      if (i == 0 || balance < lowest_balance) {
-        lowest_balance = balance;
-        strncpy(lowest_balance_month, months.items[i].month, sizeof(lowest_balance_month) - 1);
-        lowest_balance_month[7] = '\0';
-      }
-      if (depletion_index == -1 && balance <= 0.0) {
-        depletion_index = (int)i;
-        depletion_balance = balance;
-        strncpy(depletion_month, months.items[i].month, sizeof(depletion_month) - 1);
-        depletion_month[7] = '\0';
-      }
-      if (i == 0 || months.items[i].inflow > peak_inflow) {
-        peak_inflow = months.items[i].inflow;
-        strncpy(peak_inflow_month, months.items[i].month, sizeof(peak_inflow_month) - 1);
-        peak_inflow_month[7] = '\0';
-      }
-      if (i == 0 || months.items[i].outflow > peak_outflow) {
-        peak_outflow = months.items[i].outflow;
-        strncpy(peak_outflow_month, months.items[i].month, sizeof(peak_outflow_month) - 1);
-        peak_outflow_month[7] = '\0';
-      }
-    }
-    ending_cash = month_balance[months.count - 1];
-  }
-
-  double largest_net_swing_abs = 0.0;
-  double largest_net_swing_delta = 0.0;
-  char largest_net_swing_month[8] = "";
-  if (months.count > 1 && month_net) {
-    for (size_t i = 1; i < months.count; i++) {
-      double delta = month_net[i] - month_net[i - 1];
-      double delta_abs = fabs(delta);
-      if (delta_abs > largest_net_swing_abs) {
-        largest_net_swing_abs = delta_abs;
-        largest_net_swing_delta = delta;
-        strncpy(largest_net_swing_month, months.items[i].month, sizeof(largest_net_swing_month) - 1);
-        largest_net_swing_month[7] = '\0';
-      }
-    }
-  }
-
-  size_t month_start = 0;
-  if (window_months > 0 && months.count > (size_t)window_months) {
-    month_start = months.count - (size_t)window_months;
   }
+  RunwaySummary s;
+  compute_summary(months.items, months.count, &params, &s, month_net, month_balance);
+  double available_cash = s.available_cash;
+  double net_trend_abs = fabs(s.net_trend_delta);
 
-  double burn_total = 0.0;
-  int burn_count = 0;
-  double net_total = 0.0;
-  double inflow_total = 0.0;
-  double outflow_total = 0.0;
-  int net_count = 0;
-  for (size_t i = month_start; i < months.count; i++) {
-    double month_net = months.items[i].inflow - months.items[i].outflow;
-    net_total += month_net;
-    inflow_total += months.items[i].inflow;
-    outflow_total += months.items[i].outflow;
-    net_count++;
-    if (month_net < 0) {
-      burn_total += -month_net;
-      burn_count++;
-    }
-  }
-
-  double avg_burn = burn_count > 0 ? burn_total / burn_count : 0.0;
-  double avg_net = net_count > 0 ? net_total / net_count : 0.0;
-  double avg_inflow = net_count > 0 ? inflow_total / net_count : 0.0;
-  double avg_outflow = net_count > 0 ? outflow_total / net_count : 0.0;
-  double outflow_coverage = avg_outflow > 0 ? available_cash / avg_outflow : 0.0;
-  double breakeven_gap = 0.0;
-  double breakeven_inflow_pct = 0.0;
-  double breakeven_outflow_pct = 0.0;
-  if (avg_outflow > avg_inflow) {
-    breakeven_gap = avg_outflow - avg_inflow;
-    if (avg_inflow > 0) {
-      breakeven_inflow_pct = (breakeven_gap / avg_inflow) * 100.0;
-    }
-    if (avg_outflow > 0) {
-      breakeven_outflow_pct = (breakeven_gap / avg_outflow) * 100.0;
-    }
-  }
-  double net_variance_sum = 0.0;
-  if (net_count > 0) {
-    for (size_t i = month_start; i < months.count; i++) {
-      double month_net = months.items[i].inflow - months.items[i].outflow;
-      double diff = month_net - avg_net;
-      net_variance_sum += diff * diff;
-    }
-  }
-  double net_volatility = net_count > 0 ? sqrt(net_variance_sum / net_count) : 0.0;
-  double runway_months = avg_burn > 0 ? available_cash / avg_burn : 0.0;
-  const char *risk_level = "not_at_risk";
-  if (avg_burn > 0) {
-    risk_level = risk_from_runway(runway_months);
-  }
-  double target_runway_months = 12.0;
-  double target_cash = avg_burn > 0 ? avg_burn * target_runway_months : 0.0;
-  double funding_gap = target_cash > available_cash ? target_cash - available_cash : 0.0;
   Scenario scenarios[] = {
       {"baseline_avg", 0.0, 0.0},
       {"inflow_up_10", 0.10, 0.0},
@@ -673,95 +4000,112 @@ int main(int argc, char **argv) {
       {"outflow_down_10", 0.0, -0.10},
   };
   size_t scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
-  size_t trend_window = 3;
-  size_t recent_start = months.count > trend_window ? months.count - trend_window : 0;
-  size_t recent_count = months.count - recent_start;
-  double recent_net_total = 0.0;
-  for (size_t i = recent_start; i < months.count; i++) {
-    recent_net_total += months.items[i].inflow - months.items[i].outflow;
-  }
-  double recent_avg_net = recent_count > 0 ? recent_net_total / (double)recent_count : 0.0;
-  size_t prior_end = recent_start;
-  size_t prior_start = prior_end > trend_window ? prior_end - trend_window : 0;
-  size_t prior_count = prior_end - prior_start;
-  double prior_net_total = 0.0;
-  for (size_t i = prior_start; i < prior_end; i++) {
-    prior_net_total += months.items[i].inflow - months.items[i].outflow;
-  }
-  double prior_avg_net = prior_count > 0 ? prior_net_total / (double)prior_count : 0.0;
-  double net_trend_delta = recent_avg_net - prior_avg_net;
-  double net_trend_abs = fabs(net_trend_delta);
 
   printf("Group Scholar Funding Runway\n");
-  printf("Records: %zu | Months: %zu | Skipped: %zu\n", record_count, months.count, skipped);
+  printf("Records: %zu | Months: %zu | Skipped: %zu | Filtered: %zu\n", record_count, months.count, skipped, filtered);
+  char date_format[16];
+  date_format_name(&ledger.date_format, date_format);
+  if (load_opts.date_format) {
+    printf("Date format: %s (--date-format) | Unparsed dates: %zu\n", date_format, ledger.date_mismatched);
+  } else if (ledger.date_matched == 0) {
+    printf("Date format: no format matched (0 of %zu sampled rows) | Unparsed dates: %zu\n", ledger.date_sampled,
+           ledger.date_mismatched);
+  } else {
+    printf("Date format: %s (detected from %zu rows) | Unparsed dates: %zu\n", date_format, ledger.date_sampled,
+           ledger.date_mismatched);
+  }
+  if (ledger.stopped_early) {
+    printf("Scan stopped early at the upper date bound (--sorted)\n");
+  }
+  if (load_opts.fx) {
+    size_t fx_rows = ledger.fx_native + ledger.fx_converted + ledger.fx_missing;
+    printf("Currency: %s | Converted rows: %zu | Missing FX rate: %zu | Coverage: %.1f%%\n",
+           fx.report_currency, ledger.fx_converted, ledger.fx_missing,
+           fx_rows > 0 ? (double)(ledger.fx_native + ledger.fx_converted) * 100.0 / (double)fx_rows : 100.0);
+  } else if (ledger.fx_unconverted > 0) {
+    printf("Currency: %zu rows not in %s summed unconverted (no --fx-rates)\n", ledger.fx_unconverted,
+           fx.report_currency);
+  }
+  if (load_opts.max_categories > 0) {
+    HeavyHitterBounds outflow_bounds;
+    heavy_hitter_bounds(&categories, total_outflow, &outflow_bounds);
+    printf("Approximate categories: top %zu per direction | Evicted: %zu outflow, %zu inflow\n",
+           load_opts.max_categories, categories.evicted, inflow_categories.evicted);
+    printf("Outflow HHI estimate: %.3f (bounds %.3f-%.3f)\n", outflow_bounds.hhi, outflow_bounds.hhi_lower,
+           outflow_bounds.hhi_upper);
+  }
+  if (load_opts.dedupe) {
+    printf("Duplicates dropped: %zu (Inflow $%.2f | Outflow $%.2f)\n",
+           ledger.duplicates, ledger.duplicate_inflow, ledger.duplicate_outflow);
+  }
   printf("Totals: Inflow $%.2f | Outflow $%.2f | Net $%.2f\n", total_inflow, total_outflow, net);
   printf("Starting cash: $%.2f | Reserved cash: $%.2f | Available: $%.2f\n", starting_cash, reserved_cash, available_cash);
-  printf("Ending cash (as of last month): $%.2f\n", ending_cash);
+  printf("Ending cash (as of last month): $%.2f\n", s.ending_cash);
   if (months.count > 0) {
-    printf("Lowest cash balance: $%.2f (%s)\n", lowest_balance, lowest_balance_month);
-    if (depletion_index >= 0) {
+    printf("Lowest cash balance: $%.2f (%s)\n", s.lowest_balance, s.lowest_balance_month);
+    if (s.depletion_index >= 0) {
       printf("Cash depletion month: %s (month %d, balance $%.2f)\n",
-             depletion_month, depletion_index + 1, depletion_balance);
+             s.depletion_month, s.depletion_index + 1, s.depletion_balance);
     } else {
       printf("Cash depletion month: None within observed period\n");
     }
-    printf("Peak inflow month: %s ($%.2f)\n", peak_inflow_month, peak_inflow);
-    printf("Peak outflow month: %s ($%.2f)\n", peak_outflow_month, peak_outflow);
-    printf("Deficit months: %d\n", deficit_months);
-    printf("Best net month: %s ($%.2f)\n", best_net_month, best_net);
-    printf("Worst net month: %s ($%.2f)\n", worst_net_month, worst_net);
-    if (longest_deficit_streak > 0) {
+    printf("Peak inflow month: %s ($%.2f)\n", s.peak_inflow_month, s.peak_inflow);
+    printf("Peak outflow month: %s ($%.2f)\n", s.peak_outflow_month, s.peak_outflow);
+    printf("Deficit months: %d\n", s.deficit_months);
+    printf("Best net month: %s ($%.2f)\n", s.best_net_month, s.best_net);
+    printf("Worst net month: %s ($%.2f)\n", s.worst_net_month, s.worst_net);
+    if (s.longest_deficit_streak > 0) {
       printf("Longest deficit streak: %d months (%s to %s)\n",
-             longest_deficit_streak, longest_deficit_start, longest_deficit_end);
+             s.longest_deficit_streak, s.longest_deficit_start, s.longest_deficit_end);
     } else {
       printf("Longest deficit streak: 0 months\n");
     }
-    if (largest_net_swing_abs > 0) {
+    if (s.largest_net_swing_abs > 0) {
       printf("Largest net swing: $%.2f (%s, delta $%.2f)\n",
-             largest_net_swing_abs, largest_net_swing_month, largest_net_swing_delta);
+             s.largest_net_swing_abs, s.largest_net_swing_month, s.largest_net_swing_delta);
     }
   }
-  if (avg_burn > 0) {
-    printf("Average monthly burn (negative net): $%.2f across %d months\n", avg_burn, burn_count);
-    printf("Average monthly net: $%.2f across %d months\n", avg_net, net_count);
-    printf("Average monthly inflow: $%.2f | Outflow: $%.2f\n", avg_inflow, avg_outflow);
-    if (breakeven_gap > 0) {
+  if (s.avg_burn > 0) {
+    printf("Average monthly burn (negative net): $%.2f across %d months\n", s.avg_burn, s.burn_count);
+    printf("Average monthly net: $%.2f across %d months\n", s.avg_net, s.net_count);
+    printf("Average monthly inflow: $%.2f | Outflow: $%.2f\n", s.avg_inflow, s.avg_outflow);
+    if (s.breakeven_gap > 0) {
       printf("Breakeven gap: $%.2f (lift inflow %.1f%% or cut outflow %.1f%%)\n",
-             breakeven_gap, breakeven_inflow_pct, breakeven_outflow_pct);
+             s.breakeven_gap, s.breakeven_inflow_pct, s.breakeven_outflow_pct);
     } else {
       printf("Breakeven gap: $0.00 (already net-positive on average)\n");
     }
-    printf("Net volatility (std dev): $%.2f\n", net_volatility);
-    printf("Recent %zu-month average net: $%.2f\n", recent_count, recent_avg_net);
-    printf("Estimated runway: %.1f months\n", runway_months);
-    printf("Runway risk: %s\n", risk_level);
+    printf("Net volatility (std dev): $%.2f\n", s.net_volatility);
+    printf("Recent %zu-month average net: $%.2f\n", s.recent_count, s.recent_avg_net);
+    printf("Estimated runway: %.1f months (from available cash $%.2f)\n", s.runway_months, s.available_cash);
+    printf("Runway risk: %s\n", s.risk_level);
   } else {
     printf("Average monthly burn: $0.00 (no negative net months)\n");
-    printf("Average monthly net: $%.2f across %d months\n", avg_net, net_count);
-    printf("Average monthly inflow: $%.2f | Outflow: $%.2f\n", avg_inflow, avg_outflow);
-    if (breakeven_gap > 0) {
+    printf("Average monthly net: $%.2f across %d months\n", s.avg_net, s.net_count);
+    printf("Average monthly inflow: $%.2f | Outflow: $%.2f\n", s.avg_inflow, s.avg_outflow);
+    if (s.breakeven_gap > 0) {
       printf("Breakeven gap: $%.2f (lift inflow %.1f%% or cut outflow %.1f%%)\n",
-             breakeven_gap, breakeven_inflow_pct, breakeven_outflow_pct);
+             s.breakeven_gap, s.breakeven_inflow_pct, s.breakeven_outflow_pct);
     } else {
       printf("Breakeven gap: $0.00 (already net-positive on average)\n");
     }
-    printf("Net volatility (std dev): $%.2f\n", net_volatility);
-    printf("Recent %zu-month average net: $%.2f\n", recent_count, recent_avg_net);
+    printf("Net volatility (std dev): $%.2f\n", s.net_volatility);
+    printf("Recent %zu-month average net: $%.2f\n", s.recent_count, s.recent_avg_net);
     printf("Estimated runway: Not at risk based on current net flow\n");
-    printf("Runway risk: %s\n", risk_level);
+    printf("Runway risk: %s\n", s.risk_level);
   }
-  if (avg_burn > 0) {
+  if (s.avg_burn > 0) {
     printf("Target runway: %.0f months | Target cash: $%.2f | Funding gap: $%.2f\n",
-           target_runway_months, target_cash, funding_gap);
+           s.target_runway_months, s.target_cash, s.funding_gap);
   } else {
-    printf("Target runway: %.0f months | Target cash: $0.00 | Funding gap: $0.00\n", target_runway_months);
+    printf("Target runway: %.0f months | Target cash: $0.00 | Funding gap: $0.00\n", s.target_runway_months);
   }
-  if (avg_outflow > 0) {
-    printf("Outflow coverage: %.1f months of average spend\n", outflow_coverage);
+  if (s.avg_outflow > 0) {
+    printf("Outflow coverage: %.1f months of average spend\n", s.outflow_coverage);
   }
-  if (prior_count > 0) {
-    printf("Prior %zu-month average net: $%.2f\n", prior_count, prior_avg_net);
-    printf("Net trend: %s $%.2f\n", net_trend_delta >= 0 ? "improving by" : "declining by", net_trend_abs);
+  if (s.prior_count > 0) {
+    printf("Prior %zu-month average net: $%.2f\n", s.prior_count, s.prior_avg_net);
+    printf("Net trend: %s $%.2f\n", s.net_trend_delta >= 0 ? "improving by" : "declining by", net_trend_abs);
   } else {
     printf("Net trend: Not enough history for comparison\n");
   }
@@ -775,13 +4119,11 @@ int main(int argc, char **argv) {
            outflow_hhi, top_outflow_share * 100.0);
   }
 
-  printf("\nRunway scenarios (avg flows):\n");
+  printf("\nRunway scenarios (avg flows, from available cash $%.2f):\n", available_cash);
   for (size_t i = 0; i < scenario_count; i++) {
-    double scenario_inflow = avg_inflow * (1.0 + scenarios[i].inflow_adj);
-    double scenario_outflow = avg_outflow * (1.0 + scenarios[i].outflow_adj);
-    double scenario_net = scenario_inflow - scenario_outflow;
-    double scenario_runway = scenario_net < 0 ? available_cash / (-scenario_net) : 0.0;
-    const char *scenario_risk = scenario_net < 0 ? risk_from_runway(scenario_runway) : "not_at_risk";
+    double scenario_net = 0.0;
+    double scenario_runway = 0.0;
+    const char *scenario_risk = project_scenario(&scenarios[i], &s, &scenario_net, &scenario_runway);
     if (scenario_net < 0) {
       printf("  %s | Net $%.2f | Runway %.1f months | Risk %s\n",
              scenarios[i].name, scenario_net, scenario_runway, scenario_risk);
@@ -791,6 +4133,67 @@ int main(int argc, char **argv) {
     }
   }
 
+  Commitments commitments;
+  memset(&commitments, 0, sizeof(commitments));
+  Projection projections[sizeof(scenarios) / sizeof(scenarios[0])];
+  double *projection_path = NULL;
+  /* Projections continue the month balance path from the month after the last actual (or as-of) month. */
+  double projection_start = s.ending_cash;
+  if (commitments_path) {
+    /*
+     * Always continue from the last actual month: ending cash is that month's
+     * balance, so a later --as-of must not skip the run rate and commitments
+     * of the months in between.
+     */
+    int last_key = months.count > 0 ? month_key_from(months.items[months.count - 1].month) : 0;
+    if (last_key == 0) {
+      fprintf(stderr, "No actual months to project commitments from.\n");
+      free(month_net);
+      free(month_balance);
+      ledger_free(&ledger);
+      fx_table_free(&fx);
+      return 1;
+    }
+    if (load_commitments(commitments_path, last_key + 1, horizon_months, &commitments) != 0) {
+      commitments_free(&commitments);
+      free(month_net);
+      free(month_balance);
+      ledger_free(&ledger);
+      fx_table_free(&fx);
+      return 1;
+    }
+    projection_path = calloc((size_t)horizon_months, sizeof(double));
+    if (!projection_path) {
+      fprintf(stderr, "Memory allocation failed for projection.\n");
+      exit(1);
+    }
+    for (size_t i = 0; i < scenario_count; i++) {
+      project_commitments(&commitments, &scenarios[i], &s, projection_start, i == 0 ? projection_path : NULL,
+                          &projections[i]);
+    }
+    char first_month[8];
+    char last_month[8];
+    month_from_key(commitments.start_key, first_month);
+    month_from_key(commitments.start_key + horizon_months - 1, last_month);
+    printf("\nForward projection (%zu commitments, %s to %s, from ending cash $%.2f):\n", commitments.rows, first_month,
+           last_month, projection_start);
+    printf("  Committed: inflow $%.2f | outflow $%.2f\n", commitments.total_inflow, commitments.total_outflow);
+    for (size_t i = 0; i < scenario_count; i++) {
+      const Projection *p = &projections[i];
+      char min_month[8];
+      month_from_key(commitments.start_key + (p->min_index >= 0 ? p->min_index : 0), min_month);
+      if (p->depletion_index >= 0) {
+        char depletion_month[8];
+        month_from_key(commitments.start_key + p->depletion_index, depletion_month);
+        printf("  %s | Depletes %s (month %d) | Min $%.2f (%s) | End $%.2f\n", scenarios[i].name, depletion_month,
+               p->depletion_index + 1, p->min_balance, p->min_index >= 0 ? min_month : "start", p->ending_balance);
+      } else {
+        printf("  %s | No depletion | Min $%.2f (%s) | End $%.2f\n", scenarios[i].name, p->min_balance,
+               p->min_index >= 0 ? min_month : "start", p->ending_balance);
+      }
+    }
+  }
+
   printf("\nRecent months:\n");
   size_t recent_display_start = months.count > 6 ? months.count - 6 : 0;
   for (size_t i = recent_display_start; i < months.count; i++) {
@@ -820,6 +4223,160 @@ int main(int argc, char **argv) {
     }
   }
 
+  if (ledger.outflow_digest.total_weight > 0 || ledger.inflow_digest.total_weight > 0) {
+    printf("\nTransaction sizes (median | P90 | P99):\n");
+    if (ledger.outflow_digest.total_weight > 0) {
+      printf("  Outflow | $%.2f | $%.2f | $%.2f\n", tdigest_quantile(&ledger.outflow_digest, 0.5),
+             tdigest_quantile(&ledger.outflow_digest, 0.9), tdigest_quantile(&ledger.outflow_digest, 0.99));
+    }
+    if (ledger.inflow_digest.total_weight > 0) {
+      printf("  Inflow | $%.2f | $%.2f | $%.2f\n", tdigest_quantile(&ledger.inflow_digest, 0.5),
+             tdigest_quantile(&ledger.inflow_digest, 0.9), tdigest_quantile(&ledger.inflow_digest, 0.99));
+    }
+    size_t top = categories.count > 5 ? 5 : categories.count;
+    for (size_t i = 0; i < top; i++) {
+      TDigest *digest = &categories.items[i].digest;
+      printf("  %s | $%.2f | $%.2f | $%.2f\n", categories.items[i].name, tdigest_quantile(digest, 0.5),
+             tdigest_quantile(digest, 0.9), tdigest_quantile(digest, 0.99));
+    }
+  }
+  MonthTotals month_totals;
+  month_totals_build(&months, &month_totals);
+  size_t cube_cells = cube_cell_count(&categories) + cube_cell_count(&inflow_categories);
+  if (categories.count > 0) {
+    printf("\nCategory trends (%zu category-month cells, %zu KB):\n", cube_cells,
+           (cube_cells * sizeof(CategoryMonth) + 1023) / 1024);
+    size_t top = categories.count > 5 ? 5 : categories.count;
+    for (size_t i = 0; i < top; i++) {
+      CategoryTrend trend;
+      category_trend(&categories.items[i], &month_totals, month_totals.outflow, &trend);
+      char month[8];
+      month_from_key(trend.peak_key, month);
+      printf("  %s | %zu months | %+.2f/month | share %+.2f pts/month | peak %s $%.2f\n", categories.items[i].name,
+             trend.active_months, trend.slope, trend.share_slope, month, trend.peak_amount);
+    }
+  }
+  AnomalyList anomalies = {0};
+  detect_anomalies(&ledger, anomaly_z, &anomalies);
+  if (anomalies.count > 0) {
+    printf("\nCategory anomalies (|z| > %.1f):\n", anomaly_z);
+    size_t shown = anomalies.count > 10 ? 10 : anomalies.count;
+    for (size_t i = anomalies.count - shown; i < anomalies.count; i++) {
+      const Anomaly *item = &anomalies.items[i];
+      char month[8];
+      month_from_key(item->month_key, month);
+      if (strcmp(item->kind, "spike") == 0 || strcmp(item->kind, "drop") == 0) {
+        printf("  %s | %s (%s) | %s $%.2f vs avg $%.2f (z %.1f)\n", month, item->category, item->direction,
+               item->kind, item->amount, item->mean, item->z);
+      } else {
+        printf("  %s | %s (%s) | %s\n", month, item->category, item->direction, item->kind);
+      }
+    }
+  }
+  size_t sensitivity_count = 0;
+  Sensitivity *sensitivity = solve_sensitivity(&ledger, &s, sensitivity_cut, &sensitivity_count);
+  /* With no cash to stretch every cut leaves the runway where it is; say so once instead of per category. */
+  int sensitivity_moves = 0;
+  for (size_t i = 0; i < sensitivity_count && !sensitivity_moves; i++) {
+    const Sensitivity *item = &sensitivity[i];
+    sensitivity_moves = item->min_cut >= 0 || item->burn_months == 0 ||
+                        fabs(item->runway_months - s.runway_months) >= 0.05;
+  }
+  if (sensitivity_count > 0 && s.avg_burn > 0 && !sensitivity_moves) {
+    printf("\nCategory sensitivity (cut %.0f%%, target %.0f months): no category cut changes the %.1f-month runway "
+           "(available cash $%.2f)\n",
+           sensitivity_cut * 100.0, s.target_runway_months, s.runway_months, s.available_cash);
+  } else if (sensitivity_count > 0 && s.avg_burn > 0) {
+    printf("\nCategory sensitivity (cut %.0f%%, target %.0f months):\n", sensitivity_cut * 100.0,
+           s.target_runway_months);
+    size_t shown = sensitivity_count > 10 ? 10 : sensitivity_count;
+    for (size_t i = 0; i < shown; i++) {
+      const Sensitivity *item = &sensitivity[i];
+      char runway_text[32];
+      char cut_text[48];
+      if (item->burn_months == 0) {
+        snprintf(runway_text, sizeof(runway_text), "no burn");
+      } else {
+        snprintf(runway_text, sizeof(runway_text), "%.1f months", item->runway_months);
+      }
+      if (item->min_cut < 0) {
+        snprintf(cut_text, sizeof(cut_text), "target out of reach");
+      } else {
+        snprintf(cut_text, sizeof(cut_text), "target at %.1f%% cut", item->min_cut * 100.0);
+      }
+      printf("  %s | runway %s | %s\n", item->category, runway_text, cut_text);
+    }
+  }
+  Budget budget = {0};
+  BudgetReport budget_report;
+  memset(&budget_report, 0, sizeof(budget_report));
+  if (budget_path) {
+    if (load_budget(budget_path, &budget) != 0) {
+      free(anomalies.items);
+      month_totals_free(&month_totals);
+      free(sensitivity);
+      free(month_net);
+      free(month_balance);
+      ledger_free(&ledger);
+      fx_table_free(&fx);
+      return 1;
+    }
+    budget_join(&budget, &ledger, &s,
+                load_opts.category_count > 0 || load_opts.exclude_count > 0 || load_opts.restricted_only,
+                &budget_report);
+    char first_month[8] = "";
+    char last_month[8] = "";
+    if (budget.count > 0) {
+      month_from_key(budget.first_key, first_month);
+      month_from_key(budget.last_key, last_month);
+    }
+    printf("\nBudget vs actual (%zu lines, %s to %s):\n", budget.count, first_month, last_month);
+    if (budget_report.filtered || budget_report.approximate > 0) {
+      printf("  Partial: actuals miss %s%s%s\n",
+             budget_report.filtered ? "rows removed by category/restricted filters" : "",
+             budget_report.filtered && budget_report.approximate > 0 ? " and " : "",
+             budget_report.approximate > 0 ? "early months of approximate (--max-categories) categories" : "");
+    }
+    printf("  Outflow: budget $%.2f | actual $%.2f | variance $%.2f\n", budget_report.budget_outflow,
+           budget_report.actual_outflow, budget_report.actual_outflow - budget_report.budget_outflow);
+    if (budget.has_inflow) {
+      printf("  Inflow: budget $%.2f | actual $%.2f | variance $%.2f\n", budget_report.budget_inflow,
+             budget_report.actual_inflow, budget_report.actual_inflow - budget_report.budget_inflow);
+    }
+    if (budget_report.overlap_months > 0) {
+      printf("  Burn vs plan: actual $%.2f/month vs planned $%.2f/month (%.1f%% of plan, %zu months)\n",
+             budget_report.actual_avg_outflow, budget_report.planned_avg_outflow,
+             budget_report.planned_avg_outflow > 0
+                 ? budget_report.actual_avg_outflow / budget_report.planned_avg_outflow * 100.0
+                 : 0.0,
+             budget_report.overlap_months);
+    }
+    if (budget_report.plan_net < 0) {
+      printf("  Runway under budget: %.1f months (%s) from ending cash $%.2f | planned net $%.2f/month over %zu plan "
+             "months\n",
+             budget_report.runway_months, budget_report.risk, budget_report.starting_balance, budget_report.plan_net,
+             budget_report.plan_months);
+    } else {
+      printf("  Runway under budget: not burning | planned net $%.2f/month over %zu plan months\n",
+             budget_report.plan_net, budget_report.plan_months);
+    }
+    printf("  Unbudgeted actuals: outflow $%.2f | inflow $%.2f across %zu category-months\n",
+           budget_report.unbudgeted_outflow, budget_report.unbudgeted_inflow, budget_report.unbudgeted_cells);
+    size_t shown = budget_report.categories.count > 5 ? 5 : budget_report.categories.count;
+    for (size_t i = 0; i < shown; i++) {
+      const BudgetCategory *item = &budget_report.categories.items[i];
+      printf("  %s | budget $%.2f | actual $%.2f | variance $%.2f\n", item->category, item->budget, item->actual,
+             item->actual - item->budget);
+    }
+  }
+  if (ledger.largest_count > 0) {
+    printf("\nLargest outflows:\n");
+    size_t top = ledger.largest_count > 5 ? 5 : ledger.largest_count;
+    for (size_t i = 0; i < top; i++) {
+      printf("  %s | %s | $%.2f\n", ledger.largest[i].date, ledger.largest[i].category, ledger.largest[i].amount);
+    }
+  }
+
   if (json_path) {
     FILE *out = fopen(json_path, "w");
     if (!out) {
@@ -829,6 +4386,66 @@ int main(int argc, char **argv) {
       fprintf(out, "  \"records\": %zu,\n", record_count);
       fprintf(out, "  \"months\": %zu,\n", months.count);
       fprintf(out, "  \"skipped\": %zu,\n", skipped);
+      fprintf(out, "  \"filtered\": %zu,\n", filtered);
+      fprintf(out, "  \"dates\": {\n");
+      if (load_opts.date_format || ledger.date_matched > 0) {
+        fprintf(out, "    \"format\": \"%s\",\n", date_format);
+      } else {
+        fprintf(out, "    \"format\": null,\n");
+      }
+      fprintf(out, "    \"detected\": %s,\n", load_opts.date_format ? "false" : "true");
+      fprintf(out, "    \"sampled_rows\": %zu,\n", ledger.date_sampled);
+      fprintf(out, "    \"matched_sample_rows\": %zu,\n", ledger.date_matched);
+      fprintf(out, "    \"unparsed_rows\": %zu\n", ledger.date_mismatched);
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"filters\": {\n");
+      fprintf(out, "    \"from\": \"%s\",\n", load_opts.from);
+      fprintf(out, "    \"to\": \"%s\",\n", load_opts.to);
+      fprintf(out, "    \"categories\": [");
+      for (size_t i = 0; i < load_opts.category_count; i++) {
+        if (i > 0) fprintf(out, ", ");
+        fprint_json_string(out, load_opts.categories[i]);
+      }
+      fprintf(out, "],\n");
+      fprintf(out, "    \"exclude_categories\": [");
+      for (size_t i = 0; i < load_opts.exclude_count; i++) {
+        if (i > 0) fprintf(out, ", ");
+        fprint_json_string(out, load_opts.exclude_categories[i]);
+      }
+      fprintf(out, "],\n");
+      fprintf(out, "    \"restricted_only\": %s,\n", load_opts.restricted_only ? "true" : "false");
+      fprintf(out, "    \"stopped_early\": %s\n", ledger.stopped_early ? "true" : "false");
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"dedupe\": {\n");
+      fprintf(out, "    \"enabled\": %s,\n", load_opts.dedupe ? "true" : "false");
+      fprintf(out, "    \"duplicates\": %zu,\n", ledger.duplicates);
+      fprintf(out, "    \"duplicate_inflow\": %.2f,\n", ledger.duplicate_inflow);
+      fprintf(out, "    \"duplicate_outflow\": %.2f,\n", ledger.duplicate_outflow);
+      fprintf(out, "    \"unique_rows\": %zu,\n", ledger.dedupe_unique);
+      fprintf(out, "    \"hash_set_bytes\": %zu\n", ledger.dedupe_bytes);
+      fprintf(out, "  },\n");
+      size_t fx_rows = ledger.fx_native + ledger.fx_converted + ledger.fx_missing;
+      fprintf(out, "  \"fx\": {\n");
+      fprintf(out, "    \"enabled\": %s,\n", load_opts.fx ? "true" : "false");
+      fprintf(out, "    \"report_currency\": \"%s\",\n", fx.report_currency);
+      fprintf(out, "    \"native_rows\": %zu,\n", ledger.fx_native);
+      fprintf(out, "    \"converted_rows\": %zu,\n", ledger.fx_converted);
+      fprintf(out, "    \"missing_rate_rows\": %zu,\n", ledger.fx_missing);
+      fprintf(out, "    \"unknown_currency_rows\": %zu,\n", ledger.fx_unknown);
+      fprintf(out, "    \"unconverted_rows\": %zu,\n", ledger.fx_unconverted);
+      fprintf(out, "    \"coverage_pct\": %.2f,\n",
+              fx_rows > 0 ? (double)(ledger.fx_native + ledger.fx_converted) * 100.0 / (double)fx_rows : 100.0);
+      fprintf(out, "    \"currencies\": [\n");
+      for (size_t i = 0; i < fx.count; i++) {
+        const FxSeries *series = &fx.items[i];
+        fprintf(out,
+                "      {\"currency\": \"%s\", \"rate_points\": %zu, \"rows\": %zu, \"missing_rows\": %zu, "
+                "\"native_amount\": %.2f, \"converted_amount\": %.2f}%s\n",
+                series->code, series->count, series->rows, series->missing, series->native_total,
+                series->converted_total, i + 1 < fx.count ? "," : "");
+      }
+      fprintf(out, "    ]\n");
+      fprintf(out, "  },\n");
       fprintf(out, "  \"totals\": {\n");
       fprintf(out, "    \"inflow\": %.2f,\n", total_inflow);
       fprintf(out, "    \"outflow\": %.2f,\n", total_outflow);
@@ -840,69 +4457,70 @@ int main(int argc, char **argv) {
       fprintf(out, "    \"available\": %.2f\n", available_cash);
       fprintf(out, "  },\n");
       fprintf(out, "  \"cash_flow\": {\n");
-      fprintf(out, "    \"ending_balance\": %.2f,\n", ending_cash);
-      fprintf(out, "    \"lowest_balance\": %.2f,\n", lowest_balance);
-      fprintf(out, "    \"lowest_balance_month\": \"%s\",\n", months.count > 0 ? lowest_balance_month : "");
-      fprintf(out, "    \"depletion_balance\": %.2f,\n", depletion_index >= 0 ? depletion_balance : 0.0);
-      fprintf(out, "    \"depletion_month\": \"%s\",\n", depletion_index >= 0 ? depletion_month : "");
-      fprintf(out, "    \"depletion_month_index\": %d,\n", depletion_index >= 0 ? depletion_index + 1 : 0);
-      fprintf(out, "    \"peak_inflow\": %.2f,\n", peak_inflow);
-      fprintf(out, "    \"peak_inflow_month\": \"%s\",\n", months.count > 0 ? peak_inflow_month : "");
-      fprintf(out, "    \"peak_outflow\": %.2f,\n", peak_outflow);
-      fprintf(out, "    \"peak_outflow_month\": \"%s\",\n", months.count > 0 ? peak_outflow_month : "");
-      fprintf(out, "    \"deficit_months\": %d\n", deficit_months);
+      fprintf(out, "    \"ending_balance\": %.2f,\n", s.ending_cash);
+      fprintf(out, "    \"lowest_balance\": %.2f,\n", s.lowest_balance);
+      fprintf(out, "    \"lowest_balance_month\": \"%s\",\n", months.count > 0 ? s.lowest_balance_month : "");
+      fprintf(out, "    \"depletion_balance\": %.2f,\n", s.depletion_index >= 0 ? s.depletion_balance : 0.0);
+      fprintf(out, "    \"depletion_month\": \"%s\",\n", s.depletion_index >= 0 ? s.depletion_month : "");
+      fprintf(out, "    \"depletion_month_index\": %d,\n", s.depletion_index >= 0 ? s.depletion_index + 1 : 0);
+      fprintf(out, "    \"peak_inflow\": %.2f,\n", s.peak_inflow);
+      fprintf(out, "    \"peak_inflow_month\": \"%s\",\n", months.count > 0 ? s.peak_inflow_month : "");
+      fprintf(out, "    \"peak_outflow\": %.2f,\n", s.peak_outflow);
+      fprintf(out, "    \"peak_outflow_month\": \"%s\",\n", months.count > 0 ? s.peak_outflow_month : "");
+      fprintf(out, "    \"deficit_months\": %d\n", s.deficit_months);
       fprintf(out, "  },\n");
       fprintf(out, "  \"net_extremes\": {\n");
-      fprintf(out, "    \"best_month\": \"%s\",\n", months.count > 0 ? best_net_month : "");
-      fprintf(out, "    \"best_value\": %.2f,\n", best_net);
-      fprintf(out, "    \"worst_month\": \"%s\",\n", months.count > 0 ? worst_net_month : "");
-      fprintf(out, "    \"worst_value\": %.2f\n", worst_net);
+      fprintf(out, "    \"best_month\": \"%s\",\n", months.count > 0 ? s.best_net_month : "");
+      fprintf(out, "    \"best_value\": %.2f,\n", s.best_net);
+      fprintf(out, "    \"worst_month\": \"%s\",\n", months.count > 0 ? s.worst_net_month : "");
+      fprintf(out, "    \"worst_value\": %.2f\n", s.worst_net);
       fprintf(out, "  },\n");
       fprintf(out, "  \"deficit_streak\": {\n");
-      fprintf(out, "    \"longest_months\": %d,\n", longest_deficit_streak);
-      fprintf(out, "    \"start_month\": \"%s\",\n", longest_deficit_streak > 0 ? longest_deficit_start : "");
-      fprintf(out, "    \"end_month\": \"%s\"\n", longest_deficit_streak > 0 ? longest_deficit_end : "");
+      fprintf(out, "    \"longest_months\": %d,\n", s.longest_deficit_streak);
+      fprintf(out, "    \"start_month\": \"%s\",\n", s.longest_deficit_streak > 0 ? s.longest_deficit_start : "");
+      fprintf(out, "    \"end_month\": \"%s\"\n", s.longest_deficit_streak > 0 ? s.longest_deficit_end : "");
       fprintf(out, "  },\n");
       fprintf(out, "  \"net_swing\": {\n");
-      fprintf(out, "    \"largest_abs\": %.2f,\n", largest_net_swing_abs);
-      fprintf(out, "    \"largest_delta\": %.2f,\n", largest_net_swing_delta);
-      fprintf(out, "    \"largest_month\": \"%s\"\n", largest_net_swing_month);
+      fprintf(out, "    \"largest_abs\": %.2f,\n", s.largest_net_swing_abs);
+      fprintf(out, "    \"largest_delta\": %.2f,\n", s.largest_net_swing_delta);
+      fprintf(out, "    \"largest_month\": \"%s\"\n", s.largest_net_swing_month);
       fprintf(out, "  },\n");
       fprintf(out, "  \"as_of\": \"%s\",\n", as_of[0] ? as_of : "");
       fprintf(out, "  \"window_months\": %d,\n", window_months);
-      fprintf(out, "  \"runway_risk\": \"%s\",\n", risk_level);
+      fprintf(out, "  \"runway_risk\": \"%s\",\n", s.risk_level);
       fprintf(out, "  \"burn\": {\n");
-      fprintf(out, "    \"average_monthly\": %.2f,\n", avg_burn);
-      fprintf(out, "    \"months_used\": %d,\n", burn_count);
-      fprintf(out, "    \"estimated_runway_months\": %.2f\n", runway_months);
+      fprintf(out, "    \"average_monthly\": %.2f,\n", s.avg_burn);
+      fprintf(out, "    \"months_used\": %d,\n", s.burn_count);
+      fprintf(out, "    \"cash_basis\": \"available\",\n");
+      fprintf(out, "    \"estimated_runway_months\": %.2f\n", s.runway_months);
       fprintf(out, "  },\n");
       fprintf(out, "  \"flows\": {\n");
-      fprintf(out, "    \"average_inflow\": %.2f,\n", avg_inflow);
-      fprintf(out, "    \"average_outflow\": %.2f,\n", avg_outflow);
-      fprintf(out, "    \"outflow_coverage_months\": %.2f\n", outflow_coverage);
+      fprintf(out, "    \"average_inflow\": %.2f,\n", s.avg_inflow);
+      fprintf(out, "    \"average_outflow\": %.2f,\n", s.avg_outflow);
+      fprintf(out, "    \"outflow_coverage_months\": %.2f\n", s.outflow_coverage);
       fprintf(out, "  },\n");
       fprintf(out, "  \"breakeven\": {\n");
-      fprintf(out, "    \"gap\": %.2f,\n", breakeven_gap);
-      fprintf(out, "    \"inflow_lift_pct\": %.2f,\n", breakeven_inflow_pct);
-      fprintf(out, "    \"outflow_cut_pct\": %.2f\n", breakeven_outflow_pct);
+      fprintf(out, "    \"gap\": %.2f,\n", s.breakeven_gap);
+      fprintf(out, "    \"inflow_lift_pct\": %.2f,\n", s.breakeven_inflow_pct);
+      fprintf(out, "    \"outflow_cut_pct\": %.2f\n", s.breakeven_outflow_pct);
       fprintf(out, "  },\n");
       fprintf(out, "  \"net\": {\n");
-      fprintf(out, "    \"average_monthly\": %.2f,\n", avg_net);
-      fprintf(out, "    \"months_used\": %d,\n", net_count);
-      fprintf(out, "    \"volatility\": %.2f\n", net_volatility);
+      fprintf(out, "    \"average_monthly\": %.2f,\n", s.avg_net);
+      fprintf(out, "    \"months_used\": %d,\n", s.net_count);
+      fprintf(out, "    \"volatility\": %.2f\n", s.net_volatility);
       fprintf(out, "  },\n");
       fprintf(out, "  \"targets\": {\n");
-      fprintf(out, "    \"runway_months\": %.2f,\n", target_runway_months);
-      fprintf(out, "    \"target_cash\": %.2f,\n", target_cash);
-      fprintf(out, "    \"funding_gap\": %.2f\n", funding_gap);
+      fprintf(out, "    \"runway_months\": %.2f,\n", s.target_runway_months);
+      fprintf(out, "    \"target_cash\": %.2f,\n", s.target_cash);
+      fprintf(out, "    \"funding_gap\": %.2f\n", s.funding_gap);
       fprintf(out, "  },\n");
       fprintf(out, "  \"net_trend\": {\n");
-      fprintf(out, "    \"window_months\": %zu,\n", trend_window);
-      fprintf(out, "    \"recent_average\": %.2f,\n", recent_avg_net);
-      fprintf(out, "    \"recent_months\": %zu,\n", recent_count);
-      fprintf(out, "    \"prior_average\": %.2f,\n", prior_avg_net);
-      fprintf(out, "    \"prior_months\": %zu,\n", prior_count);
-      fprintf(out, "    \"delta\": %.2f\n", net_trend_delta);
+      fprintf(out, "    \"window_months\": %zu,\n", s.trend_window);
+      fprintf(out, "    \"recent_average\": %.2f,\n", s.recent_avg_net);
+      fprintf(out, "    \"recent_months\": %zu,\n", s.recent_count);
+      fprintf(out, "    \"prior_average\": %.2f,\n", s.prior_avg_net);
+      fprintf(out, "    \"prior_months\": %zu,\n", s.prior_count);
+      fprintf(out, "    \"delta\": %.2f\n", s.net_trend_delta);
       fprintf(out, "  },\n");
       fprintf(out, "  \"restricted\": {\n");
       fprintf(out, "    \"outflow_total\": %.2f\n", total_restricted);
@@ -914,7 +4532,7 @@ int main(int argc, char **argv) {
       fprintf(out, "    \"top_outflow_share_pct\": %.2f\n", top_outflow_share * 100.0);
       fprintf(out, "  },\n");
       fprintf(out, "  \"recent_months\": [\n");
-      for (size_t i = recent_start; i < months.count; i++) {
+      for (size_t i = s.recent_start; i < months.count; i++) {
         double month_net_value = month_net ? month_net[i] : months.items[i].inflow - months.items[i].outflow;
         fprintf(out, "    {\"month\": \"%s\", \"inflow\": %.2f, \"outflow\": %.2f, \"net\": %.2f}%s\n",
                 months.items[i].month, months.items[i].inflow, months.items[i].outflow, month_net_value,
@@ -949,13 +4567,200 @@ int main(int argc, char **argv) {
                 i + 1 < inflow_top ? "," : "");
       }
       fprintf(out, "  ],\n");
+      fprintf(out, "  \"heavy_hitters\": {\n");
+      fprintf(out, "    \"enabled\": %s,\n", load_opts.max_categories > 0 ? "true" : "false");
+      fprintf(out, "    \"max_categories\": %zu,\n", load_opts.max_categories);
+      write_heavy_hitters(out, "outflow", &categories, total_outflow, 0);
+      write_heavy_hitters(out, "inflow", &inflow_categories, total_inflow, 1);
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"transaction_sizes\": {\n");
+      fprintf(out, "    \"outflow\": {");
+      write_digest_fields(out, &ledger.outflow_digest);
+      fprintf(out, "},\n");
+      fprintf(out, "    \"inflow\": {");
+      write_digest_fields(out, &ledger.inflow_digest);
+      fprintf(out, "},\n");
+      fprintf(out, "    \"categories\": [\n");
+      size_t size_rows = categories.count + inflow_categories.count;
+      for (size_t i = 0; i < size_rows; i++) {
+        int is_outflow_row = i < categories.count;
+        CategoryStat *stat = is_outflow_row ? &categories.items[i] : &inflow_categories.items[i - categories.count];
+        fprintf(out, "      {\"category\": ");
+        fprint_json_string(out, stat->name);
+        fprintf(out, ", \"direction\": \"%s\", ", is_outflow_row ? "outflow" : "inflow");
+        write_digest_fields(out, &stat->digest);
+        fprintf(out, "}%s\n", i + 1 < size_rows ? "," : "");
+      }
+      fprintf(out, "    ],\n");
+      fprintf(out, "    \"largest_outflows\": [\n");
+      for (size_t i = 0; i < ledger.largest_count; i++) {
+        fprintf(out, "      {\"date\": ");
+        fprint_json_string(out, ledger.largest[i].date);
+        fprintf(out, ", \"category\": ");
+        fprint_json_string(out, ledger.largest[i].category);
+        fprintf(out, ", \"amount\": %.2f}%s\n", ledger.largest[i].amount, i + 1 < ledger.largest_count ? "," : "");
+      }
+      fprintf(out, "    ]\n");
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"category_months\": {\n");
+      fprintf(out, "    \"cells\": %zu,\n", cube_cells);
+      fprintf(out, "    \"cell_bytes\": %zu,\n", cube_cells * sizeof(CategoryMonth));
+      write_cube_json(out, "outflow", &categories, &month_totals, month_totals.outflow, 0);
+      write_cube_json(out, "inflow", &inflow_categories, &month_totals, month_totals.inflow, 1);
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"anomalies\": {\n");
+      fprintf(out, "    \"z_threshold\": %.2f,\n", anomaly_z);
+      fprintf(out, "    \"count\": %zu,\n", anomalies.count);
+      fprintf(out, "    \"flags\": [\n");
+      for (size_t i = 0; i < anomalies.count; i++) {
+        const Anomaly *item = &anomalies.items[i];
+        char month[8];
+        month_from_key(item->month_key, month);
+        fprintf(out, "      {\"month\": \"%s\", \"category\": ", month);
+        fprint_json_string(out, item->category);
+        fprintf(out, ", \"direction\": \"%s\"", item->direction);
+        fprintf(out, ", \"kind\": \"%s\", \"amount\": %.2f, \"mean\": %.2f, \"std_dev\": %.2f, \"z\": %.2f}%s\n",
+                item->kind, item->amount, item->mean, item->std_dev, item->z, i + 1 < anomalies.count ? "," : "");
+      }
+      fprintf(out, "    ]\n");
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"sensitivity\": {\n");
+      fprintf(out, "    \"cut_pct\": %.2f,\n", sensitivity_cut * 100.0);
+      fprintf(out, "    \"target_runway_months\": %.2f,\n", s.target_runway_months);
+      fprintf(out, "    \"baseline_runway_months\": %.2f,\n", s.runway_months);
+      fprintf(out, "    \"baseline_avg_burn\": %.2f,\n", s.avg_burn);
+      fprintf(out, "    \"categories\": [\n");
+      for (size_t i = 0; i < sensitivity_count; i++) {
+        const Sensitivity *item = &sensitivity[i];
+        fprintf(out, "      {\"category\": ");
+        fprint_json_string(out, item->category);
+        fprintf(out, ", \"window_outflow\": %.2f, \"avg_burn\": %.2f, \"burn_months\": %d, ",
+                item->window_outflow, item->avg_burn, item->burn_months);
+        if (item->burn_months == 0) {
+          fprintf(out, "\"runway_months\": null, ");
+        } else {
+          fprintf(out, "\"runway_months\": %.2f, ", item->runway_months);
+        }
+        if (item->min_cut < 0) {
+          fprintf(out, "\"min_cut_pct\": null}");
+        } else {
+          fprintf(out, "\"min_cut_pct\": %.2f}", item->min_cut * 100.0);
+        }
+        fprintf(out, "%s\n", i + 1 < sensitivity_count ? "," : "");
+      }
+      fprintf(out, "    ]\n");
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"budget\": {\n");
+      fprintf(out, "    \"enabled\": %s,\n", budget_path ? "true" : "false");
+      fprintf(out, "    \"lines\": %zu,\n", budget.count);
+      fprintf(out, "    \"matched_lines\": %zu,\n", budget_report.matched_lines);
+      fprintf(out, "    \"rejected_rows\": %zu,\n", budget.rejected);
+      fprintf(out, "    \"partial\": %s,\n",
+              budget_report.filtered || budget_report.approximate > 0 ? "true" : "false");
+      fprintf(out, "    \"filtered\": %s,\n", budget_report.filtered ? "true" : "false");
+      fprintf(out, "    \"approximate_categories\": %zu,\n", budget_report.approximate);
+      fprintf(out, "    \"budget_outflow\": %.2f,\n", budget_report.budget_outflow);
+      fprintf(out, "    \"actual_outflow\": %.2f,\n", budget_report.actual_outflow);
+      fprintf(out, "    \"outflow_variance\": %.2f,\n", budget_report.actual_outflow - budget_report.budget_outflow);
+      fprintf(out, "    \"budget_inflow\": %.2f,\n", budget_report.budget_inflow);
+      fprintf(out, "    \"actual_inflow\": %.2f,\n", budget_report.actual_inflow);
+      fprintf(out, "    \"inflow_variance\": %.2f,\n", budget_report.actual_inflow - budget_report.budget_inflow);
+      fprintf(out, "    \"overlap_months\": %zu,\n", budget_report.overlap_months);
+      fprintf(out, "    \"planned_avg_outflow\": %.2f,\n", budget_report.planned_avg_outflow);
+      fprintf(out, "    \"actual_avg_outflow\": %.2f,\n", budget_report.actual_avg_outflow);
+      fprintf(out, "    \"burn_vs_plan_pct\": %.2f,\n",
+              budget_report.planned_avg_outflow > 0
+                  ? budget_report.actual_avg_outflow / budget_report.planned_avg_outflow * 100.0
+                  : 0.0);
+      fprintf(out, "    \"plan_months\": %zu,\n", budget_report.plan_months);
+      fprintf(out, "    \"plan_avg_inflow\": %.2f,\n", budget_report.plan_avg_inflow);
+      fprintf(out, "    \"plan_avg_outflow\": %.2f,\n", budget_report.plan_avg_outflow);
+      fprintf(out, "    \"plan_net\": %.2f,\n", budget_report.plan_net);
+      fprintf(out, "    \"runway_cash_basis\": \"ending_balance\",\n");
+      fprintf(out, "    \"runway_starting_balance\": %.2f,\n", budget_report.starting_balance);
+      if (budget_report.plan_net < 0) {
+        fprintf(out, "    \"runway_under_budget_months\": %.2f,\n", budget_report.runway_months);
+      } else {
+        fprintf(out, "    \"runway_under_budget_months\": null,\n");
+      }
+      fprintf(out, "    \"runway_under_budget_risk\": \"%s\",\n", budget_report.risk);
+      fprintf(out, "    \"unbudgeted_outflow\": %.2f,\n", budget_report.unbudgeted_outflow);
+      fprintf(out, "    \"unbudgeted_inflow\": %.2f,\n", budget_report.unbudgeted_inflow);
+      fprintf(out, "    \"unbudgeted_cells\": %zu,\n", budget_report.unbudgeted_cells);
+      for (int list_index = 0; list_index < 2; list_index++) {
+        const BudgetCategoryList *list = list_index == 0 ? &budget_report.categories : &budget_report.unbudgeted;
+        fprintf(out, "    \"%s\": [\n", list_index == 0 ? "categories" : "unbudgeted");
+        for (size_t i = 0; i < list->count; i++) {
+          const BudgetCategory *item = &list->items[i];
+          fprintf(out, "      {\"category\": ");
+          fprint_json_string(out, item->category);
+          fprintf(out,
+                  ", \"direction\": \"%s\", \"budget\": %.2f, \"actual\": %.2f, \"variance\": %.2f, "
+                  "\"variance_pct\": %.2f, \"months\": %zu}%s\n",
+                  item->is_inflow ? "inflow" : "outflow", item->budget, item->actual, item->actual - item->budget,
+                  item->budget > 0 ? (item->actual - item->budget) / item->budget * 100.0 : 0.0, item->months,
+                  i + 1 < list->count ? "," : "");
+        }
+        fprintf(out, "    ]%s\n", list_index == 0 ? "," : "");
+      }
+      fprintf(out, "  },\n");
+      fprintf(out, "  \"projection\": {\n");
+      fprintf(out, "    \"enabled\": %s,\n", commitments_path ? "true" : "false");
+      if (commitments_path) {
+        char month[8];
+        month_from_key(commitments.start_key, month);
+        fprintf(out, "    \"start_month\": \"%s\",\n", month);
+        fprintf(out, "    \"horizon_months\": %d,\n", horizon_months);
+        fprintf(out, "    \"cash_basis\": \"ending_balance\",\n");
+        fprintf(out, "    \"starting_balance\": %.2f,\n", projection_start);
+        fprintf(out, "    \"commitments\": %zu,\n", commitments.rows);
+        fprintf(out, "    \"rejected_rows\": %zu,\n", commitments.rejected);
+        fprintf(out, "    \"open_ended_rows\": %zu,\n", commitments.open_ended);
+        fprintf(out, "    \"reversed_rows\": %zu,\n", commitments.reversed);
+        fprintf(out, "    \"past_occurrences\": %zu,\n", commitments.past);
+        fprintf(out, "    \"beyond_horizon\": %zu,\n", commitments.beyond);
+        fprintf(out, "    \"committed_inflow\": %.2f,\n", commitments.total_inflow);
+        fprintf(out, "    \"committed_outflow\": %.2f,\n", commitments.total_outflow);
+        fprintf(out, "    \"scenarios\": [\n");
+        for (size_t i = 0; i < scenario_count; i++) {
+          const Projection *p = &projections[i];
+          fprintf(out, "      {\"name\": \"%s\", ", scenarios[i].name);
+          if (p->depletion_index >= 0) {
+            month_from_key(commitments.start_key + p->depletion_index, month);
+            fprintf(out, "\"depletion_month\": \"%s\", \"months_to_depletion\": %d, ", month,
+                    p->depletion_index + 1);
+          } else {
+            fprintf(out, "\"depletion_month\": null, \"months_to_depletion\": null, ");
+          }
+          if (p->min_index >= 0) {
+            month_from_key(commitments.start_key + p->min_index, month);
+            fprintf(out, "\"min_balance_month\": \"%s\", ", month);
+          } else {
+            fprintf(out, "\"min_balance_month\": null, ");
+          }
+          fprintf(out, "\"min_balance\": %.2f, \"ending_balance\": %.2f}%s\n", p->min_balance, p->ending_balance,
+                  i + 1 < scenario_count ? "," : "");
+        }
+        fprintf(out, "    ],\n");
+        fprintf(out, "    \"baseline_path\": [\n");
+        for (int h = 0; h < horizon_months; h++) {
+          month_from_key(commitments.start_key + h, month);
+          fprintf(out,
+                  "      {\"month\": \"%s\", \"committed_inflow\": %.2f, \"committed_outflow\": %.2f, "
+                  "\"balance\": %.2f}%s\n",
+                  month, commitments.inflow[h], commitments.outflow[h], projection_path[h],
+                  h + 1 < horizon_months ? "," : "");
+        }
+        fprintf(out, "    ]\n");
+      } else {
+        fprintf(out, "    \"horizon_months\": %d\n", horizon_months);
+      }
+      fprintf(out, "  },\n");
       fprintf(out, "  \"scenarios\": [\n");
       for (size_t i = 0; i < scenario_count; i++) {
-        double scenario_inflow = avg_inflow * (1.0 + scenarios[i].inflow_adj);
-        double scenario_outflow = avg_outflow * (1.0 + scenarios[i].outflow_adj);
-        double scenario_net = scenario_inflow - scenario_outflow;
-        double scenario_runway = scenario_net < 0 ? available_cash / (-scenario_net) : 0.0;
-        const char *scenario_risk = scenario_net < 0 ? risk_from_runway(scenario_runway) : "not_at_risk";
+        double scenario_net = 0.0;
+        double scenario_runway = 0.0;
+        const char *scenario_risk = project_scenario(&scenarios[i], &s, &scenario_net, &scenario_runway);
         fprintf(out,
                 "    {\"name\": \"%s\", \"inflow_adj_pct\": %.1f, \"outflow_adj_pct\": %.1f, \"projected_net\": %.2f, "
                 "\"projected_runway_months\": %.2f, \"risk\": \"%s\"}%s\n",
@@ -970,10 +4775,69 @@ int main(int argc, char **argv) {
     }
   }
 
-  free(months.items);
-  free(categories.items);
+  int status = 0;
+  if (arrow_dir) {
+    if (write_arrow_report(arrow_dir, &ledger, &s, month_net, month_balance, scenarios, scenario_count) == 0) {
+      printf("Arrow tables written to %s\n", arrow_dir);
+    } else {
+      status = 1;
+    }
+  }
+
+  if (history_path) {
+    HistoryRecord record;
+    memset(&record, 0, sizeof(record));
+    record.run_time = (int64_t)time(NULL);
+    record.as_of_key = as_of[0] ? month_key_from(as_of)
+                                : months.count > 0 ? month_key_from(months.items[months.count - 1].month) : 0;
+    record.month_count = (int32_t)months.count;
+    record.window_months = window_months;
+    record.record_count = (int32_t)record_count;
+    record.starting_cash = starting_cash;
+    record.reserved_cash = reserved_cash;
+    record.total_inflow = total_inflow;
+    record.total_outflow = total_outflow;
+    record.available_cash = s.available_cash;
+    record.ending_cash = s.ending_cash;
+    record.lowest_balance = s.lowest_balance;
+    record.avg_inflow = s.avg_inflow;
+    record.avg_outflow = s.avg_outflow;
+    record.avg_burn = s.avg_burn;
+    record.avg_net = s.avg_net;
+    record.net_volatility = s.net_volatility;
+    record.runway_months = s.runway_months;
+    record.funding_gap = s.funding_gap;
+    record.net_trend_delta = s.net_trend_delta;
+    snprintf(record.risk, sizeof(record.risk), "%s", s.risk_level);
+    HistoryMonth *history_months = calloc(months.count > 0 ? months.count : 1, sizeof(HistoryMonth));
+    if (!history_months) {
+      fprintf(stderr, "Memory allocation failed for history months.\n");
+      exit(1);
+    }
+    for (size_t i = 0; i < months.count; i++) {
+      history_months[i].month_key = month_key_from(months.items[i].month);
+      history_months[i].inflow = months.items[i].inflow;
+      history_months[i].outflow = months.items[i].outflow;
+      history_months[i].balance = month_balance[i];
+    }
+    if (history_append(history_path, &record, history_months) == 0) {
+      printf("Run appended to history %s\n", history_path);
+    } else {
+      status = 1;
+    }
+    free(history_months);
+  }
+
+  free(anomalies.items);
+  month_totals_free(&month_totals);
+  free(sensitivity);
+  budget_report_free(&budget_report);
+  budget_free(&budget);
+  commitments_free(&commitments);
+  free(projection_path);
   free(month_net);
   free(month_balance);
-  free(inflow_categories.items);
-  return 0;
+  ledger_free(&ledger);
+  fx_table_free(&fx);
+  return status;
 }
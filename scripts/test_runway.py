@@ -1,18 +1,448 @@
 #!/usr/bin/env python3
 import json
 import os
+import struct
 import subprocess
 import tempfile
 
 ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
 BIN = os.path.join(ROOT, "funding-runway")
 SAMPLE = os.path.join(ROOT, "samples", "runway_sample.csv")
+QUERIES = os.path.join(ROOT, "samples", "runway_queries.csv")
+MULTICURRENCY = os.path.join(ROOT, "samples", "runway_multicurrency.csv")
+BUDGET = os.path.join(ROOT, "samples", "runway_budget.csv")
+COMMITMENTS = os.path.join(ROOT, "samples", "runway_commitments.csv")
+FX_RATES = os.path.join(ROOT, "samples", "fx_rates.csv")
 
 
 def run(cmd):
     subprocess.run(cmd, check=True)
 
 
+def run_capture(cmd):
+    return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+
+def check_queries(payload):
+    output = run_capture([BIN, "--file", SAMPLE, "--window", "6", "--queries", QUERIES])
+    answers = [json.loads(line) for line in output.splitlines() if line.strip()]
+    assert len(answers) == 5
+    baseline = answers[0]
+    assert baseline["id"] == "baseline"
+    assert abs(baseline["estimated_runway_months"] - payload["burn"]["estimated_runway_months"]) < 0.01
+    assert abs(baseline["ending_balance"] - payload["cash_flow"]["ending_balance"]) < 0.01
+    mid_year = answers[1]
+    assert mid_year["as_of"] == "2025-06"
+    assert mid_year["months"] == 6
+    capped = run_capture([BIN, "--file", SAMPLE, "--window", "6", "--as-of", "2025-09", "--queries", QUERIES])
+    capped_answers = {item["id"]: item for item in map(json.loads, capped.splitlines())}
+    assert "error" in capped_answers["short_window"] and "error" in capped_answers["lean_reserves"]
+    assert capped_answers["mid_year"]["months"] == 6 and "error" not in capped_answers["q3_close"]
+
+
+def check_dedupe(tmpdir, payload):
+    with open(SAMPLE, "r", encoding="utf-8") as handle:
+        lines = handle.read().splitlines()
+    overlap_path = os.path.join(tmpdir, "overlap.csv")
+    with open(overlap_path, "w", encoding="utf-8") as handle:
+        handle.write("\n".join(lines + lines[1:6]) + "\n")
+    out_path = os.path.join(tmpdir, "dedupe.json")
+    run([BIN, "--file", overlap_path, "--starting-cash", "450000", "--dedupe", "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        deduped = json.load(handle)
+    assert deduped["dedupe"]["duplicates"] == 5
+    assert deduped["records"] == payload["records"]
+    assert abs(deduped["totals"]["outflow"] - payload["totals"]["outflow"]) < 0.01
+
+
+def check_fx(tmpdir):
+    out_path = os.path.join(tmpdir, "fx.json")
+    run([BIN, "--file", MULTICURRENCY, "--starting-cash", "200000", "--fx-rates", FX_RATES, "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    fx = payload["fx"]
+    assert fx["enabled"] is True
+    assert fx["report_currency"] == "USD"
+    assert fx["missing_rate_rows"] == 1
+    currencies = {item["currency"]: item for item in fx["currencies"]}
+    # EUR rows: Feb 12000 @1.08, Feb 6500 @1.08, Apr 7000 @1.07, May 9000 @1.08, Jun 7400 @1.10
+    assert abs(currencies["EUR"]["converted_amount"] - 45330.0) < 0.01
+    assert payload["records"] == 17
+    assert payload["skipped"] == fx["missing_rate_rows"]
+    assert fx["unconverted_rows"] == 0
+    unconverted_path = os.path.join(tmpdir, "fx_unconverted.json")
+    run([BIN, "--file", MULTICURRENCY, "--starting-cash", "200000", "--json", unconverted_path])
+    with open(unconverted_path, "r", encoding="utf-8") as handle:
+        unconverted = json.load(handle)
+    assert unconverted["fx"]["enabled"] is False
+    assert unconverted["fx"]["unconverted_rows"] > 0
+    assert unconverted["fx"]["currencies"] == []
+
+
+def check_arrow(tmpdir, payload):
+    arrow_dir = os.path.join(tmpdir, "arrow")
+    run([BIN, "--file", SAMPLE, "--starting-cash", "450000", "--reserved-cash", "60000", "--window", "6", "--arrow", arrow_dir])
+    for name in ("months", "categories", "category_months", "scenarios"):
+        with open(os.path.join(arrow_dir, f"{name}.arrow"), "rb") as handle:
+            data = handle.read()
+        assert data[:6] == b"ARROW1" and data[-6:] == b"ARROW1"
+        footer_length = struct.unpack("<i", data[-10:-6])[0]
+        assert 0 < footer_length < len(data)
+    try:
+        import pyarrow.ipc
+    except ImportError:
+        return
+    months = pyarrow.ipc.open_file(os.path.join(arrow_dir, "months.arrow")).read_all()
+    assert months.num_rows == payload["months"]
+    assert months.column("balance").to_pylist()[-1] == payload["cash_flow"]["ending_balance"]
+    cube = pyarrow.ipc.open_file(os.path.join(arrow_dir, "category_months.arrow")).read_all()
+    assert cube.num_rows == payload["category_months"]["cells"]
+    scenarios = pyarrow.ipc.open_file(os.path.join(arrow_dir, "scenarios.arrow")).read_all()
+    assert scenarios.column("name").to_pylist() == [item["name"] for item in payload["scenarios"]]
+
+
+def check_anomalies(tmpdir):
+    ledger_path = os.path.join(tmpdir, "anomaly.csv")
+    with open(ledger_path, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,category\n")
+        for month in range(1, 13):
+            handle.write(f"2025-{month:02d}-05,{10000 + month * 10},outflow,Operations\n")
+            handle.write(f"2025-{month:02d}-06,20000,inflow,Grant\n")
+        handle.write("2025-12-20,40000,outflow,Operations\n")
+        handle.write("2025-06-10,3000,outflow,Pilot\n")
+        handle.write("2025-09-15,8000,inflow,Gala\n")
+        for month in range(1, 9):
+            handle.write(f"2025-{month:02d}-12,{5000 + month % 2 * 10},outflow,Lease\n")
+        for month in range(2, 12):
+            handle.write(f"2025-{month:02d}-08,1500,outflow,Software\n")
+    out_path = os.path.join(tmpdir, "anomaly.json")
+    run([BIN, "--file", ledger_path, "--starting-cash", "100000", "--anomaly-z", "3", "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        flags = json.load(handle)["anomalies"]["flags"]
+    kinds = {(item["category"], item["month"], item["kind"]) for item in flags}
+    assert ("Operations", "2025-12", "spike") in kinds
+    assert {item["direction"] for item in flags if item["category"] == "Gala"} == {"inflow"}
+    assert ("Gala", "2025-09", "new") in kinds
+    assert not [item for item in flags if item["category"] == "Software"]
+    assert [item["kind"] for item in flags if item["category"] == "Lease"] == ["disappeared"]
+    assert ("Pilot", "2025-06", "new") in kinds
+    assert ("Pilot", "2025-07", "disappeared") in kinds
+
+
+def check_heavy_hitters(tmpdir):
+    ledger_path = os.path.join(tmpdir, "memo.csv")
+    with open(ledger_path, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,memo\n")
+        for i in range(3000):
+            handle.write(f"2025-{i % 12 + 1:02d}-10,{25 + i % 7},outflow,Card purchase {i}\n")
+            if i % 3 == 0:
+                handle.write(f"2025-{i % 12 + 1:02d}-11,900,outflow,Payroll\n")
+        handle.write("2025-01-02,50000,inflow,Grant\n")
+    out_path = os.path.join(tmpdir, "memo.json")
+    run([BIN, "--file", ledger_path, "--starting-cash", "100000", "--max-categories", "16", "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    outflow = payload["heavy_hitters"]["outflow"]
+    assert outflow["tracked"] == 16
+    assert outflow["evicted"] > 0
+    assert outflow["top"][0]["category"] == "Payroll"
+    assert outflow["top"][0]["error"] == 0
+    assert outflow["hhi_lower"] <= outflow["hhi_estimate"] <= outflow["hhi_upper"]
+    assert payload["transaction_sizes"]["outflow"]["count"] == 4000
+
+    refund_path = os.path.join(tmpdir, "refund.csv")
+    with open(refund_path, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,category\n")
+        handle.write("2025-01-05,100,outflow,Alpha\n")
+        handle.write("2025-01-06,50,outflow,Beta\n")
+        handle.write("2025-01-07,-90,outflow,Alpha\n")
+        handle.write("2025-01-08,5,outflow,Gamma\n")
+        handle.write("2025-01-09,1000,inflow,Grant\n")
+    refund_json = os.path.join(tmpdir, "refund.json")
+    run([BIN, "--file", refund_path, "--starting-cash", "1000", "--max-categories", "2", "--json", refund_json])
+    with open(refund_json, "r", encoding="utf-8") as handle:
+        top = {item["category"]: item for item in json.load(handle)["heavy_hitters"]["outflow"]["top"]}
+    # The refund shrank Alpha below Beta, so Alpha is the one evicted.
+    assert set(top) == {"Beta", "Gamma"}
+    assert top["Beta"]["error"] == 0
+    assert abs(top["Gamma"]["error"] - 10) < 0.01
+
+
+def check_date_formats(tmpdir, payload):
+    assert payload["dates"]["format"] == "YYYY-MM-DD"
+    assert payload["dates"]["unparsed_rows"] == 0
+    with open(SAMPLE, "r", encoding="utf-8") as handle:
+        header, *rows = handle.read().splitlines()
+    layouts = {
+        "MM/DD/YYYY": lambda y, m, d: f"{m}/{d}/{y}",
+        "DD.MM.YYYY": lambda y, m, d: f"{d}.{m}.{y}",
+        "DD/MM/YYYY": lambda y, m, d: f"{d}/{m}/{y}",
+    }
+    for name, layout in layouts.items():
+        ledger_path = os.path.join(tmpdir, "dates.csv")
+        with open(ledger_path, "w", encoding="utf-8") as handle:
+            handle.write(header + "\n")
+            for row in rows:
+                date, rest = row.split(",", 1)
+                handle.write(layout(*date.split("-")) + "," + rest + "\n")
+            handle.write("2025-13-45,100,outflow,Bad Date,false\n")
+        out_path = os.path.join(tmpdir, "dates.json")
+        run([BIN, "--file", ledger_path, "--starting-cash", "450000", "--reserved-cash", "60000",
+             "--window", "6", "--json", out_path])
+        with open(out_path, "r", encoding="utf-8") as handle:
+            converted = json.load(handle)
+        assert converted["dates"]["format"] == name
+        assert converted["dates"]["unparsed_rows"] == 1
+        assert converted["months"] == payload["months"]
+        assert converted["totals"] == payload["totals"]
+        assert converted["transaction_sizes"]["largest_outflows"] == payload["transaction_sizes"]["largest_outflows"]
+    month_path = os.path.join(tmpdir, "month_dates.csv")
+    with open(month_path, "w", encoding="utf-8") as handle:
+        handle.write(header + "\n")
+        for row in rows:
+            handle.write(row[:7] + row[10:] + "\n")
+    out_path = os.path.join(tmpdir, "month_dates.json")
+    run([BIN, "--file", month_path, "--starting-cash", "450000", "--reserved-cash", "60000", "--window", "6",
+         "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        monthly = json.load(handle)
+    assert monthly["dates"]["format"] == "YYYY-MM"
+    assert monthly["skipped"] == 0
+    assert monthly["months"] == payload["months"]
+    assert monthly["totals"] == payload["totals"]
+    bad_path = os.path.join(tmpdir, "bad_dates.csv")
+    with open(bad_path, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,category\nlast week,100,outflow,Ops\n")
+    run([BIN, "--file", bad_path, "--starting-cash", "1000", "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        dates = json.load(handle)["dates"]
+    assert dates["format"] is None and dates["matched_sample_rows"] == 0
+
+
+def check_history(tmpdir):
+    history_path = os.path.join(tmpdir, "runway.hist")
+    for as_of in ("2025-06", "2025-12", "2025-12", "2025-09"):
+        run([BIN, "--file", SAMPLE, "--starting-cash", "450000", "--window", "6", "--as-of", as_of,
+             "--history-file", history_path])
+        if as_of == "2025-12":
+            with open(history_path + ".idx", "ab") as handle:
+                handle.write(b"torn")
+    out_path = os.path.join(tmpdir, "history.json")
+    run([BIN, "--history", history_path, "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    assert payload["snapshots"] == 4
+    assert [point["as_of"] for point in payload["trend"]] == ["2025-06", "2025-09", "2025-12"]
+    first, last = payload["trend"][0], payload["trend"][-1]
+    assert abs(payload["runway_change"] - (last["runway_months"] - first["runway_months"])) < 0.02
+    # latest is the newest run, not the greatest as-of month.
+    assert payload["latest"]["as_of"] == "2025-09"
+    assert len(payload["latest"]["months"]) == 9
+    assert payload["latest"]["months"][-1]["balance"] == payload["trend"][1]["ending_cash"]
+    rejected = subprocess.run([BIN, "--file", SAMPLE, "--queries", QUERIES, "--history-file", history_path],
+                              capture_output=True, text=True)
+    assert rejected.returncode != 0 and "--history-file" in rejected.stderr
+
+
+def check_sensitivity(tmpdir):
+    def report(ledger_path, name):
+        out_path = os.path.join(tmpdir, name)
+        run([BIN, "--file", ledger_path, "--starting-cash", "150000", "--window", "6", "--json", out_path])
+        with open(out_path, "r", encoding="utf-8") as handle:
+            return json.load(handle)
+
+    no_cash = run_capture([BIN, "--file", SAMPLE, "--starting-cash", "0", "--window", "6"])
+    assert "no category cut changes" in no_cash and "target out of reach" not in no_cash
+    payload = report(SAMPLE, "sensitivity.json")
+    sensitivity = payload["sensitivity"]
+    assert sensitivity["cut_pct"] == 10
+    assert sensitivity["baseline_runway_months"] < sensitivity["target_runway_months"]
+    top = sensitivity["categories"][0]
+    assert top["runway_months"] > sensitivity["baseline_runway_months"]
+    assert 0 < top["min_cut_pct"] < 100
+    assert any(item["min_cut_pct"] is None for item in sensitivity["categories"])
+
+    with open(SAMPLE, "r", encoding="utf-8") as handle:
+        header, *rows = handle.read().splitlines()
+
+    def cut_runway(fraction):
+        ledger_path = os.path.join(tmpdir, "cut.csv")
+        with open(ledger_path, "w", encoding="utf-8") as handle:
+            handle.write(header + "\n")
+            for row in rows:
+                fields = row.split(",")
+                if fields[3] == top["category"] and fields[2] == "outflow":
+                    fields[1] = f"{float(fields[1]) * (1 - fraction):.6f}"
+                handle.write(",".join(fields) + "\n")
+        return report(ledger_path, "cut.json")["burn"]["estimated_runway_months"]
+
+    assert abs(cut_runway(0.10) - top["runway_months"]) < 0.01
+    assert abs(cut_runway(top["min_cut_pct"] / 100 + 1e-6) - sensitivity["target_runway_months"]) < 0.01
+
+
+def check_category_months(payload):
+    cube = payload["category_months"]
+    balances = {item["month"]: item for item in payload["month_balances"]}
+    assert cube["cells"] == sum(len(item["months"]) for item in cube["outflow"] + cube["inflow"])
+    for direction in ("outflow", "inflow"):
+        sums = {}
+        for item in cube[direction]:
+            assert abs(sum(cell["amount"] for cell in item["months"]) - item["total"]) < 0.01
+            for cell in item["months"]:
+                sums[cell["month"]] = sums.get(cell["month"], 0.0) + cell["amount"]
+        for month, amount in sums.items():
+            assert abs(balances[month][direction] - amount) < 0.01
+
+    months = [item["month"] for item in payload["month_balances"]]
+    top = cube["outflow"][0]
+    amounts = {cell["month"]: cell["amount"] for cell in top["months"]}
+    ys = [amounts.get(month, 0.0) for month in months]
+    n = len(ys)
+    mean_x = (n - 1) / 2
+    mean_y = sum(ys) / n
+    slope = sum((x - mean_x) * (y - mean_y) for x, y in enumerate(ys)) / sum((x - mean_x) ** 2 for x in range(n))
+    assert abs(slope - top["trend_slope"]) < 0.01
+
+
+def check_budget(tmpdir):
+    out_path = os.path.join(tmpdir, "budget.json")
+    run([BIN, "--file", SAMPLE, "--starting-cash", "150000", "--window", "6", "--budget", BUDGET, "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    budget = payload["budget"]
+    assert budget["enabled"] is True
+    assert budget["lines"] == 90
+    cube = {item["category"]: item for item in payload["category_months"]["outflow"]}
+    for item in budget["categories"]:
+        assert abs(item["variance"] - (item["actual"] - item["budget"])) < 0.01
+        assert abs(item["actual"] - cube[item["category"]]["total"]) < 0.01
+    assert abs(sum(item["actual"] for item in budget["categories"]) - budget["actual_outflow"]) < 0.01
+    assert [item["category"] for item in budget["unbudgeted"]] == ["Program Travel"]
+    assert abs(budget["unbudgeted_outflow"] + budget["actual_outflow"] - payload["totals"]["outflow"]) < 0.01
+    assert budget["plan_months"] == 6
+    assert budget["plan_net"] < 0
+    assert budget["partial"] is False
+    assert budget["runway_starting_balance"] == payload["cash_flow"]["ending_balance"]
+    assert abs(budget["runway_under_budget_months"] - budget["runway_starting_balance"] / -budget["plan_net"]) < 0.01
+    run([BIN, "--file", SAMPLE, "--starting-cash", "150000", "--window", "6", "--budget", BUDGET,
+         "--exclude-category", "Staff*", "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        filtered = json.load(handle)["budget"]
+    assert filtered["partial"] is True and filtered["filtered"] is True
+    long_name = "Community partnership programming and regional outreach for scholar cohorts"
+    assert len(long_name) > 63
+    long_ledger = os.path.join(tmpdir, "long_category.csv")
+    long_budget = os.path.join(tmpdir, "long_budget.csv")
+    with open(long_ledger, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,category\n2025-01-05,5000,inflow,Grant\n")
+        handle.write(f"2025-01-10,100,outflow,{long_name}\n2025-02-10,100,outflow,{long_name}\n")
+    with open(long_budget, "w", encoding="utf-8") as handle:
+        handle.write("month,category,amount\n")
+        handle.write(f"2025-01,{long_name},60\n2025-01,{long_name},40\n2025-02,{long_name},100\n")
+    run([BIN, "--file", long_ledger, "--starting-cash", "1000", "--budget", long_budget, "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        long_report = json.load(handle)["budget"]
+    assert long_report["lines"] == 2 and long_report["matched_lines"] == 2
+    assert abs(long_report["outflow_variance"]) < 0.01 and long_report["unbudgeted"] == []
+
+
+def check_commitments(tmpdir, payload):
+    assert payload["projection"]["enabled"] is False
+    out_path = os.path.join(tmpdir, "projection.json")
+    run(
+        [
+            BIN,
+            "--file",
+            SAMPLE,
+            "--starting-cash",
+            "0",
+            "--window",
+            "6",
+            "--commitments",
+            COMMITMENTS,
+            "--horizon",
+            "120",
+            "--json",
+            out_path,
+        ]
+    )
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    projection = payload["projection"]
+    assert projection["start_month"] == "2026-01"
+    assert projection["commitments"] == 7
+    assert projection["past_occurrences"] == 1
+    assert projection["beyond_horizon"] == 0
+    path = projection["baseline_path"]
+    assert len(path) == 120
+    assert abs(sum(item["committed_inflow"] for item in path) - projection["committed_inflow"]) < 0.01
+    assert abs(sum(item["committed_outflow"] for item in path) - projection["committed_outflow"]) < 0.01
+    base_net = payload["flows"]["average_inflow"] - payload["flows"]["average_outflow"]
+    balance = projection["starting_balance"]
+    for item in path:
+        balance += base_net + item["committed_inflow"] - item["committed_outflow"]
+        assert abs(item["balance"] - balance) < 0.05
+    baseline = projection["scenarios"][0]
+    assert baseline["name"] == "baseline_avg"
+    assert abs(baseline["ending_balance"] - path[-1]["balance"]) < 0.01
+    assert abs(baseline["min_balance"] - min(item["balance"] for item in path)) < 0.01
+    depleted = [item["month"] for item in path if item["balance"] <= 0]
+    assert baseline["depletion_month"] == (depleted[0] if depleted else None)
+    assert any(item["depletion_month"] for item in projection["scenarios"])
+    assert projection["cash_basis"] == "ending_balance"
+    assert projection["starting_balance"] == payload["cash_flow"]["ending_balance"]
+    assert payload["burn"]["cash_basis"] == "available"
+    late_path = os.path.join(tmpdir, "projection_late.json")
+    run([BIN, "--file", SAMPLE, "--starting-cash", "0", "--window", "6", "--as-of", "2027-06", "--commitments",
+         COMMITMENTS, "--horizon", "120", "--json", late_path])
+    with open(late_path, "r", encoding="utf-8") as handle:
+        late = json.load(handle)["projection"]
+    assert late["start_month"] == "2026-01"
+    assert late["past_occurrences"] == projection["past_occurrences"]
+    assert late["baseline_path"] == projection["baseline_path"]
+    odd_path = os.path.join(tmpdir, "odd_commitments.csv")
+    with open(odd_path, "w", encoding="utf-8") as handle:
+        handle.write("date,amount,type,end,every\n")
+        handle.write("2026-02-01,5000,outflow,,3\n")
+        handle.write("2026-06-01,5000,outflow,2026-03-01,\n")
+        handle.write("2026-04-01,7000,inflow,,\n")
+    run([BIN, "--file", SAMPLE, "--starting-cash", "0", "--commitments", odd_path, "--json", out_path])
+    with open(out_path, "r", encoding="utf-8") as handle:
+        odd = json.load(handle)["projection"]
+    assert odd["commitments"] == 1
+    assert odd["open_ended_rows"] == 1 and odd["reversed_rows"] == 1
+    assert odd["committed_outflow"] == 0 and odd["committed_inflow"] == 7000
+
+
+def check_filters(tmpdir):
+    out_path = os.path.join(tmpdir, "filtered.json")
+    run(
+        [
+            BIN,
+            "--file",
+            SAMPLE,
+            "--starting-cash",
+            "450000",
+            "--from",
+            "2025-03",
+            "--to",
+            "2025-06-30",
+            "--exclude-category",
+            "*grant*",
+            "--sorted",
+            "--json",
+            out_path,
+        ]
+    )
+    with open(out_path, "r", encoding="utf-8") as handle:
+        payload = json.load(handle)
+    assert payload["months"] == 4
+    assert payload["skipped"] == 0
+    assert payload["filtered"] > 0
+    assert payload["filters"]["stopped_early"] is True
+    assert all("Grant" not in item["category"] for item in payload["top_inflow_categories"])
+
+
 def main():
     run(["make", "-C", ROOT])
     with tempfile.TemporaryDirectory() as tmpdir:
@@ -34,6 +464,18 @@ def main():
         )
         with open(out_path, "r", encoding="utf-8") as handle:
             payload = json.load(handle)
+        check_filters(tmpdir)
+        check_date_formats(tmpdir, payload)
+        check_dedupe(tmpdir, payload)
+        check_fx(tmpdir)
+        check_arrow(tmpdir, payload)
+        check_anomalies(tmpdir)
+        check_heavy_hitters(tmpdir)
+        check_history(tmpdir)
+        check_sensitivity(tmpdir)
+        check_category_months(payload)
+        check_budget(tmpdir)
+        check_commitments(tmpdir, payload)
 
     cash_flow = payload.get("cash_flow", {})
     assert "depletion_month" in cash_flow
@@ -49,6 +491,13 @@ def main():
     assert "outflow_hhi" in concentration
     assert "top_inflow_share_pct" in concentration
     assert "top_outflow_share_pct" in concentration
+    sizes = payload.get("transaction_sizes", {})
+    outflow_sizes = sizes["outflow"]
+    assert outflow_sizes["count"] > 0
+    assert outflow_sizes["median"] <= outflow_sizes["p90"] <= outflow_sizes["p99"] <= outflow_sizes["max"]
+    assert sizes["largest_outflows"][0]["amount"] == outflow_sizes["max"]
+    assert {item["direction"] for item in sizes["categories"]} == {"inflow", "outflow"}
+    check_queries(payload)
     print("ok")
 
 